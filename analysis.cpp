@@ -0,0 +1,444 @@
+#include "analysis.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace noct
+{
+	namespace
+	{
+		auto declarationName(AST *node) -> const std::string *
+		{
+			if(auto f = dynamic_cast<ASTFunc *>(node); f != nullptr)
+				return &f->decl.name;
+			if(auto v = dynamic_cast<ASTVar *>(node); v != nullptr)
+				return &v->decl.name;
+			return nullptr;
+		}
+
+		auto isExported(AST *node) -> bool
+		{
+			if(auto f = dynamic_cast<ASTFunc *>(node); f != nullptr)
+				return f->decl.exported;
+			if(auto v = dynamic_cast<ASTVar *>(node); v != nullptr)
+				return v->decl.exported;
+			return false;
+		}
+
+		void collectReferences(AST *node, std::vector<const std::string *> &out)
+		{
+			if(auto n = dynamic_cast<ASTIdn *>(node); n != nullptr)
+				out.push_back(&n->name);
+			else if(auto n = dynamic_cast<ASTCall *>(node); n != nullptr)
+				out.push_back(&n->name);
+			else if(auto n = dynamic_cast<ASTAssign *>(node); n != nullptr)
+				out.push_back(&n->name);
+
+			forEachChild(node, [&](AST *c) { collectReferences(c, out); });
+		}
+
+		// A local of the same name counts too, which can only cost a constant.
+		void collectWrites(AST *node, std::unordered_set<std::string> &out)
+		{
+			if(auto n = dynamic_cast<ASTAssign *>(node); n != nullptr)
+				out.insert(n->name);
+
+			forEachChild(node, [&](AST *c) { collectWrites(c, out); });
+		}
+
+		// What is known about an integer local at some point: it is in [0, limit),
+		// or in [0, len(slice)) when `slice` is set.
+		struct IndexRange
+		{
+			std::uint64_t limit = 0;
+			std::string   slice;
+		};
+
+		struct RangeFacts
+		{
+			std::unordered_map<std::string, IndexRange> ranges;
+			std::unordered_set<std::string>             locals;
+		};
+
+		// Names a node may give a new value: assigned whole, or declared anew.
+		void collectRebinds(AST *node, std::unordered_set<std::string> &out)
+		{
+			if(auto n = dynamic_cast<ASTAssign *>(node);
+			   n != nullptr && n->index == nullptr && n->field.empty())
+				out.insert(n->name);
+			else if(auto n = dynamic_cast<ASTVar *>(node); n != nullptr)
+				out.insert(n->decl.name);
+
+			forEachChild(node, [&](AST *c) { collectRebinds(c, out); });
+		}
+
+		void forget(RangeFacts &facts, const std::unordered_set<std::string> &names)
+		{
+			std::erase_if(facts.ranges, [&](const auto &r) {
+				return names.count(r.first) || names.count(r.second.slice);
+			});
+		}
+
+		auto isNonNegativeConstant(AST *node) -> bool
+		{
+			auto n = dynamic_cast<ASTInt *>(node);
+			return n != nullptr && std::int64_t(n->value) >= 0;
+		}
+
+		auto getLargestValue(NumericType t) -> std::uint64_t
+		{
+			auto bits = getNumericTypeWidth(t) * 8 - isSignedNumericType(t);
+			return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+		}
+
+		auto isProvenInRange(const std::string *base, const Ptr<Type> &baseType, AST *index,
+		                     const RangeFacts &facts) -> bool
+		{
+			auto array = dynamic_cast<TypeArray *>(baseType.get());
+			if(auto n = dynamic_cast<ASTInt *>(index); n != nullptr)
+				return array != nullptr && n->value < array->count;
+
+			auto i = dynamic_cast<ASTIdn *>(index);
+			auto r = i != nullptr ? facts.ranges.find(i->name) : facts.ranges.end();
+			if(r == facts.ranges.end())
+				return false;
+			if(r->second.slice.empty())
+				return array != nullptr && r->second.limit <= array->count;
+			return base != nullptr && *base == r->second.slice;
+		}
+
+		// `while i < n { ...; i = i + 1 }`, where i is a local known not to be
+		// negative on entry, and every write to it is a statement of the body that
+		// adds a constant. Up to the first of those writes, 0 <= i < n. The sum of
+		// the steps has to fit i's type, so that i cannot wrap around before the
+		// condition sees it again.
+		auto getInductionRange(ASTWhile *loop, const RangeFacts &facts,
+		                       const std::unordered_set<std::string> &nonNegative,
+		                       const std::unordered_set<std::string> &rebound)
+		    -> std::optional<std::pair<std::string, IndexRange>>
+		{
+			auto cond = dynamic_cast<ASTBinary *>(loop->cond.get());
+			auto body = dynamic_cast<ASTBlock *>(loop->body.get());
+			if(cond == nullptr || body == nullptr)
+				return std::nullopt;
+
+			bool flipped = cond->op == '>' || cond->op == TokenType::opr_gteql;
+			bool inclusive = cond->op == TokenType::opr_lteql || cond->op == TokenType::opr_gteql;
+			if(cond->op != '<' && cond->op != TokenType::opr_lteql && !flipped)
+				return std::nullopt;
+
+			auto var = dynamic_cast<ASTIdn *>((flipped ? cond->rhs : cond->lhs).get());
+			auto limit = (flipped ? cond->lhs : cond->rhs).get();
+			auto type = var != nullptr ? dynamic_cast<TypeNumeric *>(var->checkedType.get())
+			                           : nullptr;
+			if(type == nullptr || isFloatingNumericType(type->numeric)
+			   || !facts.locals.count(var->name) || !nonNegative.count(var->name))
+				return std::nullopt;
+
+			std::unordered_set<std::string> written;
+			collectRebinds(cond, written);
+			if(written.count(var->name))
+				return std::nullopt;
+
+			std::uint64_t growth = 0;
+			for(const auto &stmt : body->nodes)
+			{
+				auto a = dynamic_cast<ASTAssign *>(stmt.get());
+				if(a != nullptr && a->name == var->name && a->index == nullptr)
+				{
+					auto sum = dynamic_cast<ASTBinary *>(a->value.get());
+					auto self = sum != nullptr ? dynamic_cast<ASTIdn *>(sum->lhs.get()) : nullptr;
+					auto step = sum != nullptr ? dynamic_cast<ASTInt *>(sum->rhs.get()) : nullptr;
+					bool adds = sum != nullptr
+					         && (sum->op == '+' || sum->op == TokenType::opr_wradd
+					             || sum->op == TokenType::opr_chadd);
+					if(!adds || self == nullptr
+					   || self->name != var->name || step == nullptr || step->value > 0xFFFFFFFF)
+						return std::nullopt;
+					growth += step->value;
+					continue;
+				}
+
+				written.clear();
+				collectRebinds(stmt.get(), written);
+				if(written.count(var->name))
+					return std::nullopt;
+			}
+
+			IndexRange range;
+			auto       largest = getLargestValue(type->numeric);
+			if(auto n = dynamic_cast<ASTInt *>(limit); n != nullptr)
+			{
+				if(n->value == 0 || n->value > largest || (inclusive && n->value == largest))
+					return std::nullopt;
+				range.limit = n->value + inclusive;
+				if(growth > largest - (range.limit - 1))
+					return std::nullopt;
+			}
+			else if(auto c = dynamic_cast<ASTCall *>(limit); c != nullptr && !inclusive
+			        && c->builtin == Builtin::len && getNumericTypeWidth(type->numeric) == 8)
+			{
+				// No slice comes near 2^63 elements, so a 64-bit i cannot wrap.
+				auto s = dynamic_cast<ASTIdn *>(c->args[0].get());
+				if(s == nullptr || !facts.locals.count(s->name) || rebound.count(s->name))
+					return std::nullopt;
+				range.slice = s->name;
+			}
+			else
+				return std::nullopt;
+
+			return std::make_pair(var->name, range);
+		}
+
+		// The variable of `parallel for i in lo..hi` stays in [lo, hi), so it is in
+		// [0, hi) when lo cannot be negative. The body cannot assign to it, nor to
+		// the slice of len(s); a declaration that hides either ends the fact there.
+		auto getParallelRange(ASTParallel *loop, const RangeFacts &facts)
+		    -> std::optional<IndexRange>
+		{
+			auto type = dynamic_cast<TypeNumeric *>(loop->varType.get());
+			if(type == nullptr
+			   || (isSignedNumericType(type->numeric) && !isNonNegativeConstant(loop->lo.get())))
+				return std::nullopt;
+
+			IndexRange range;
+			if(auto n = dynamic_cast<ASTInt *>(loop->hi.get()); n != nullptr)
+				range.limit = n->value;
+			else if(auto c = dynamic_cast<ASTCall *>(loop->hi.get());
+			        c != nullptr && c->builtin == Builtin::len)
+			{
+				auto s = dynamic_cast<ASTIdn *>(c->args[0].get());
+				if(s == nullptr || !facts.locals.count(s->name))
+					return std::nullopt;
+				range.slice = s->name;
+			}
+			else
+				return std::nullopt;
+			return range;
+		}
+
+		void checkRanges(AST *node, const RangeFacts &facts);
+
+		// Facts about a name end at the first statement that may rebind it.
+		void checkBlockRanges(ASTBlock *block, RangeFacts facts)
+		{
+			std::unordered_set<std::string> nonNegative;
+			for(const auto &stmt : block->nodes)
+			{
+				std::unordered_set<std::string> rebound;
+				collectRebinds(stmt.get(), rebound);
+				forget(facts, rebound);
+
+				if(auto loop = dynamic_cast<ASTWhile *>(stmt.get()); loop != nullptr)
+				{
+					checkRanges(loop->cond.get(), facts);
+					auto inside = facts;
+					if(auto r = getInductionRange(loop, facts, nonNegative, rebound))
+						inside.ranges[r->first] = r->second;
+					checkRanges(loop->body.get(), inside);
+				}
+				else
+					checkRanges(stmt.get(), facts);
+
+				for(const auto &name : rebound) nonNegative.erase(name);
+				if(auto v = dynamic_cast<ASTVar *>(stmt.get()); v != nullptr)
+				{
+					facts.locals.insert(v->decl.name);
+					if(isNonNegativeConstant(v->value.get()))
+						nonNegative.insert(v->decl.name);
+				}
+				else if(auto a = dynamic_cast<ASTAssign *>(stmt.get()); a != nullptr
+				        && a->index == nullptr && facts.locals.count(a->name)
+				        && isNonNegativeConstant(a->value.get()))
+					nonNegative.insert(a->name);
+			}
+		}
+
+		void checkRanges(AST *node, const RangeFacts &facts)
+		{
+			if(auto b = dynamic_cast<ASTBlock *>(node); b != nullptr)
+				return checkBlockRanges(b, facts);
+
+			if(auto f = dynamic_cast<ASTFunc *>(node); f != nullptr)
+			{
+				RangeFacts params;
+				params.locals.insert(f->decl.argNames.begin(), f->decl.argNames.end());
+				return checkRanges(f->body.get(), params);
+			}
+
+			if(auto p = dynamic_cast<ASTParallel *>(node); p != nullptr)
+			{
+				checkRanges(p->lo.get(), facts);
+				checkRanges(p->hi.get(), facts);
+				auto inside = facts;
+				inside.locals.insert(p->var);
+				inside.ranges.erase(p->var);
+				if(auto r = getParallelRange(p, facts))
+					inside.ranges[p->var] = *r;
+				return checkRanges(p->body.get(), inside);
+			}
+
+			if(auto n = dynamic_cast<ASTIndex *>(node); n != nullptr)
+			{
+				auto base = dynamic_cast<ASTIdn *>(n->base.get());
+				if(isProvenInRange(base != nullptr ? &base->name : nullptr,
+				                   n->base->checkedType, n->index.get(), facts))
+					n->boundsChecked = false;
+			}
+			else if(auto n = dynamic_cast<ASTAssign *>(node); n != nullptr && n->index != nullptr)
+			{
+				if(isProvenInRange(&n->name, n->target, n->index.get(), facts))
+					n->boundsChecked = false;
+			}
+
+			forEachChild(node, [&](AST *c) { checkRanges(c, facts); });
+		}
+
+		auto isNamed(AST *node, const std::string &name) -> bool
+		{
+			auto idn = dynamic_cast<ASTIdn *>(node);
+			return idn != nullptr && idn->name == name;
+		}
+
+		void collectParamUsage(AST *node, const std::string &name, ParamUsage &usage)
+		{
+			// Reading and writing elements, or taking the length, keeps the slice
+			// itself inside the function.
+			if(auto n = dynamic_cast<ASTIndex *>(node); n != nullptr && isNamed(n->base.get(), name))
+				return collectParamUsage(n->index.get(), name, usage);
+			if(auto n = dynamic_cast<ASTCall *>(node);
+			   n != nullptr && n->builtin == Builtin::len && isNamed(n->args[0].get(), name))
+				return;
+
+			if(isNamed(node, name))
+				usage.captured = true;
+			else if(auto n = dynamic_cast<ASTAssign *>(node);
+			        n != nullptr && n->index == nullptr && n->field.empty() && n->name == name)
+				usage.rebound = true;
+			else if(auto n = dynamic_cast<ASTVar *>(node); n != nullptr && n->decl.name == name)
+				usage.rebound = true;
+
+			forEachChild(node, [&](AST *c) { collectParamUsage(c, name, usage); });
+		}
+	} // namespace
+
+	auto getParamUsage(AST *body, const std::string &name) -> ParamUsage
+	{
+		ParamUsage usage;
+		collectParamUsage(body, name, usage);
+		return usage;
+	}
+
+	void forEachChild(AST *node, const std::function<void(AST *)> &f)
+	{
+		if(auto n = dynamic_cast<ASTVar *>(node); n != nullptr)
+		{
+			if(n->value != nullptr)
+				f(n->value.get());
+		}
+		else if(auto n = dynamic_cast<ASTFunc *>(node); n != nullptr)
+			f(n->body.get());
+		else if(auto n = dynamic_cast<ASTBlock *>(node); n != nullptr)
+			for(const auto &c : n->nodes) f(c.get());
+		else if(auto n = dynamic_cast<ASTCall *>(node); n != nullptr)
+			for(const auto &a : n->args) f(a.get());
+		else if(auto n = dynamic_cast<ASTAssign *>(node); n != nullptr)
+		{
+			if(n->index != nullptr)
+				f(n->index.get());
+			f(n->value.get());
+		}
+		else if(auto n = dynamic_cast<ASTIndex *>(node); n != nullptr)
+		{
+			f(n->base.get());
+			f(n->index.get());
+		}
+		else if(auto n = dynamic_cast<ASTField *>(node); n != nullptr)
+			f(n->base.get());
+		else if(auto n = dynamic_cast<ASTBinary *>(node); n != nullptr)
+		{
+			f(n->lhs.get());
+			f(n->rhs.get());
+		}
+		else if(auto n = dynamic_cast<ASTUnary *>(node); n != nullptr)
+			f(n->operand.get());
+		else if(auto n = dynamic_cast<ASTIf *>(node); n != nullptr)
+		{
+			f(n->cond.get());
+			f(n->then.get());
+			if(n->otherwise != nullptr)
+				f(n->otherwise.get());
+		}
+		else if(auto n = dynamic_cast<ASTWhile *>(node); n != nullptr)
+		{
+			f(n->cond.get());
+			f(n->body.get());
+		}
+		else if(auto n = dynamic_cast<ASTParallel *>(node); n != nullptr)
+		{
+			f(n->lo.get());
+			f(n->hi.get());
+			f(n->body.get());
+		}
+	}
+
+	void inferLinkage(const std::vector<Ptr<AST>> &program)
+	{
+		std::unordered_set<std::string> written;
+		for(const auto &node : program) collectWrites(node.get(), written);
+
+		for(const auto &node : program)
+		{
+			if(auto f = dynamic_cast<ASTFunc *>(node.get()); f != nullptr)
+				f->decl.exported |= f->decl.name == "main";
+			// Writes to an array may go through a slice of it, which this cannot see.
+			else if(auto v = dynamic_cast<ASTVar *>(node.get()); v != nullptr)
+				v->decl.constant = !v->decl.exported && !written.count(v->decl.name)
+				                && v->decl.type->type != TypeType::structural;
+		}
+	}
+
+	void eliminateBoundsChecks(AST *node)
+	{
+		checkRanges(node, {});
+	}
+
+	void eliminateDeadDeclarations(std::vector<Ptr<AST>> &program)
+	{
+		std::unordered_map<std::string, AST *> declarations;
+		std::unordered_set<AST *>              reachable;
+		std::vector<AST *>                     worklist;
+
+		for(const auto &node : program)
+		{
+			if(auto name = declarationName(node.get()); name != nullptr)
+				declarations.emplace(*name, node.get());
+			if(isExported(node.get()) && reachable.insert(node.get()).second)
+				worklist.push_back(node.get());
+		}
+
+		// Parameters that shadow a declaration keep it alive; that only costs a
+		// little dead code.
+		std::vector<const std::string *> references;
+		while(!worklist.empty())
+		{
+			auto *node = worklist.back();
+			worklist.pop_back();
+
+			references.clear();
+			collectReferences(node, references);
+			for(const auto *name : references)
+				if(auto d = declarations.find(*name); d != declarations.end()
+				   && reachable.insert(d->second).second)
+					worklist.push_back(d->second);
+		}
+
+		std::erase_if(program, [&](const Ptr<AST> &node) {
+			return declarationName(node.get()) != nullptr && !reachable.count(node.get());
+		});
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "util.hpp"
+#include "ast.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace noct
+{
+	// Calls `f` on each direct child of `node`.
+	void forEachChild(AST *node, const std::function<void(AST *)> &f);
+
+	// Whole-unit decisions on what the rest of the world can see. Only `pub` items
+	// and main are exported; everything else gets internal linkage, and a global
+	// that is not exported is constant unless the unit itself writes to it.
+	void inferLinkage(const std::vector<Ptr<AST>> &program);
+
+	// Marks the array and slice indexing that provably stays in range, so that it
+	// goes unchecked: constant indices into arrays, and the variables of while and
+	// parallel loops bounded by a constant or by len() of the slice they index. Run
+	// after constant folding, which turns len() of an array into a constant.
+	void eliminateBoundsChecks(AST *node);
+
+	// How a function body uses one of its parameters. It is captured when its value
+	// may outlive the call, that is, when it is used for anything but indexing and
+	// len(); it is rebound when the name is assigned or declared again.
+	struct ParamUsage
+	{
+		bool captured = false;
+		bool rebound = false;
+	};
+
+	auto getParamUsage(AST *body, const std::string &name) -> ParamUsage;
+
+	// Drops the top-level declarations that no exported one refers to, directly or
+	// through others. Run after inferLinkage, which decides what is exported.
+	void eliminateDeadDeclarations(std::vector<Ptr<AST>> &program);
+}
@@ -1,8 +1,352 @@
 #include "ast.hpp"
 #include "fmt.hpp"
+#include "generic.hpp"
+#include "literal.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <utility>
 
 namespace noct
 {
+	namespace
+	{
+		auto remember(const AST *node, TypeRes res) -> TypeRes
+		{
+			if(!res.error)
+				node->checkedType = res.value;
+			return res;
+		}
+
+		auto numericOf(const TypeRes &t) -> NumericType
+		{
+			if(auto n = dynamic_cast<TypeNumeric *>(t.value.get()); !t.error && n != nullptr)
+				return n->numeric;
+			return NumericType::unknown;
+		}
+
+		// `1 << 40` stands for a literal: a bare one shifted left by a constant,
+		// without losing bits.
+		auto getShiftedLiteral(const AST *node) -> std::optional<std::uint64_t>
+		{
+			auto b = dynamic_cast<const ASTBinary *>(node);
+			if(b == nullptr || b->op != TokenType::opr_shftl)
+				return std::nullopt;
+			auto n = dynamic_cast<ASTInt *>(b->lhs.get());
+			auto amount = dynamic_cast<ASTInt *>(b->rhs.get());
+			if(n == nullptr || n->suffixed || amount == nullptr || amount->value >= 64
+			   || (n->value << amount->value) >> amount->value != n->value)
+				return std::nullopt;
+			return n->value << amount->value;
+		}
+
+		// An untyped literal takes the type of the other operand when it fits. A
+		// float one only becomes another float type. So does a negated one, into a
+		// signed type that holds its value: `-128` fits i8.
+		auto adaptLiteral(const Ptr<AST> &node, NumericType t, NumericType other)
+		    -> NumericType
+		{
+			if(auto v = getShiftedLiteral(node.get()); v.has_value())
+				return other != NumericType::unknown && !isFloatingNumericType(other)
+				               && fitsNumericType(*v, other)
+				           ? other
+				           : t;
+
+			auto u = dynamic_cast<ASTUnary *>(node.get());
+			bool negated = u != nullptr && u->op == '-';
+			auto literal = negated ? u->operand.get() : node.get();
+
+			auto n = dynamic_cast<ASTInt *>(literal);
+			if(n != nullptr && !n->suffixed && other != NumericType::unknown
+			   && (negated ? isSignedNumericType(other)
+			                     && (n->value == 0 || fitsNumericType(n->value - 1, other))
+			               : fitsNumericType(n->value, other)))
+				return other;
+			auto f = dynamic_cast<ASTFloat *>(literal);
+			if(f != nullptr && !f->suffixed && isFloatingNumericType(other))
+				return other;
+			return t;
+		}
+
+		// Whether a lane of type `element` can take the value: anything assignable to
+		// it, and an untyped literal that fits.
+		auto acceptsScalar(NumericType element, const Ptr<AST> &node, const Ptr<Type> &t)
+		    -> bool
+		{
+			return adaptLiteral(node, NumericType::unknown, element) == element
+			    || TypeNumeric(element).assignable(t);
+		}
+
+		// The same for an element of an array or slice, which can also be a vector,
+		// and for a variable or a parameter.
+		auto acceptsElement(const Ptr<Type> &element, const Ptr<AST> &node, const Ptr<Type> &t)
+		    -> bool
+		{
+			if(auto n = dynamic_cast<TypeNumeric *>(element.get()); n != nullptr)
+				return acceptsScalar(n->numeric, node, t);
+			return element->assignable(t);
+		}
+
+		// What an index into `t` yields: a lane of a vector, or an element of an
+		// array or slice. Null for anything else.
+		auto getIndexedType(const Ptr<Type> &t) -> Ptr<Type>
+		{
+			if(auto v = dynamic_cast<TypeVector *>(t.get()); v != nullptr)
+				return makePtr<TypeNumeric>(v->element);
+			if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr)
+				return a->element;
+			if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+				return s->element;
+			return nullptr;
+		}
+
+		auto isValueType(const Ptr<Type> &t) -> bool
+		{
+			return t->type == TypeType::numeric || t->type == TypeType::vector;
+		}
+
+		// A vector comparison sets every bit of a lane that compares true, so the
+		// result works as a mask.
+		auto getMaskNumericType(NumericType t) -> NumericType
+		{
+			switch(getNumericTypeWidth(t))
+			{
+			case 1:
+				return NumericType::i8;
+			case 2:
+				return NumericType::i16;
+			case 4:
+				return NumericType::i32;
+			default:
+				return NumericType::i64;
+			}
+		}
+
+		auto getBuiltin(const std::string &name) -> Builtin
+		{
+			static const std::unordered_map<std::string, Builtin> builtins = {
+				{ "shuffle", Builtin::shuffle },
+				{ "len", Builtin::len },
+				{ "reduce_add", Builtin::reduceAdd },
+				{ "reduce_mul", Builtin::reduceMul },
+				{ "reduce_min", Builtin::reduceMin },
+				{ "reduce_max", Builtin::reduceMax },
+				{ "reduce_and", Builtin::reduceAnd },
+				{ "reduce_or", Builtin::reduceOr },
+				{ "reduce_xor", Builtin::reduceXor },
+				{ "likely", Builtin::likely },
+				{ "unlikely", Builtin::unlikely },
+			};
+
+			if(getVectorTypeByName(name) != nullptr)
+				return Builtin::vector;
+			if(auto b = builtins.find(name); b != builtins.end())
+				return b->second;
+			return Builtin::none;
+		}
+
+		auto isBitwise(char op) -> bool
+		{
+			return op == '&' || op == '|' || op == '^' || op == TokenType::opr_shftl
+			    || op == TokenType::opr_shftr;
+		}
+
+		// Wrapping and checked arithmetic is about integer overflow.
+		auto isIntegerOnly(char op) -> bool
+		{
+			return isBitwise(op) || op == TokenType::opr_wradd || op == TokenType::opr_wrsub
+			    || op == TokenType::opr_wrmul || op == TokenType::opr_chadd
+			    || op == TokenType::opr_chsub || op == TokenType::opr_chmul;
+		}
+
+		auto isComparison(char op) -> bool
+		{
+			return op == '<' || op == '>' || op == TokenType::opr_lteql
+			    || op == TokenType::opr_gteql || op == TokenType::opr_equal
+			    || op == TokenType::opr_noteq;
+		}
+
+		auto operatorName(char op) -> const char *
+		{
+			switch(op)
+			{
+			case TokenType::opr_equal:
+				return "==";
+			case TokenType::opr_noteq:
+				return "!=";
+			case TokenType::opr_d_amp:
+				return "&&";
+			case TokenType::opr_d_bar:
+				return "||";
+			case TokenType::opr_lteql:
+				return "<=";
+			case TokenType::opr_gteql:
+				return ">=";
+			case TokenType::opr_shftr:
+				return ">>";
+			case TokenType::opr_shftl:
+				return "<<";
+			case TokenType::opr_wradd:
+				return "+%";
+			case TokenType::opr_wrsub:
+				return "-%";
+			case TokenType::opr_wrmul:
+				return "*%";
+			case TokenType::opr_chadd:
+				return "+?";
+			case TokenType::opr_chsub:
+				return "-?";
+			case TokenType::opr_chmul:
+				return "*?";
+			default:
+				return nullptr;
+			}
+		}
+
+		void printOperator(std::ostream &out, char op)
+		{
+			if(auto name = operatorName(op); name != nullptr)
+				out << name;
+			else
+				out << op;
+		}
+		auto typeBuiltin(const ASTCall *call, TypecheckEnv &env) -> TypeRes
+		{
+			call->builtin = getBuiltin(call->name);
+			if(call->builtin == Builtin::none || call->args.empty())
+				return {true, nullptr};
+
+			std::vector<Ptr<Type>> types;
+			for(const auto &a : call->args)
+			{
+				auto t = a->type(env);
+				if(t.error)
+					return {true, nullptr};
+				types.push_back(t.value);
+			}
+
+			if(call->builtin == Builtin::vector)
+			{
+				auto vector = getVectorTypeByName(call->name);
+				if(call->args.size() != 1 && call->args.size() != vector->lanes)
+					return {true, nullptr};
+				for(std::size_t i = 0; i < call->args.size(); ++i)
+					if(!acceptsScalar(vector->element, call->args[i], types[i]))
+						return {true, nullptr};
+				return remember(call, {false, vector});
+			}
+
+			if(call->builtin == Builtin::len)
+			{
+				if(call->args.size() != 1 || types[0]->type != TypeType::structural)
+					return {true, nullptr};
+				return remember(call, {false, makePtr<TypeNumeric>(NumericType::u64)});
+			}
+
+			if(call->builtin == Builtin::likely || call->builtin == Builtin::unlikely)
+			{
+				auto n = dynamic_cast<TypeNumeric *>(types[0].get());
+				if(call->args.size() != 1 || n == nullptr || isFloatingNumericType(n->numeric))
+					return {true, nullptr};
+				return remember(call, {false, makePtr<TypeNumeric>(NumericType::i32)});
+			}
+
+			auto vector = std::dynamic_pointer_cast<TypeVector>(types[0]);
+			if(vector == nullptr)
+				return {true, nullptr};
+
+			if(call->builtin == Builtin::shuffle)
+			{
+				// Lane numbers are literals, so that the shuffle is a single instruction.
+				std::size_t first = 1;
+				if(call->args.size() > 1 && types[1]->type == TypeType::vector)
+				{
+					if(!vector->assignable(types[1]))
+						return {true, nullptr};
+					first = 2;
+				}
+
+				auto count = call->args.size() - first;
+				if(count < 2 || count > 64 || (count & (count - 1)) != 0)
+					return {true, nullptr};
+				for(std::size_t i = first; i < call->args.size(); ++i)
+				{
+					auto lane = dynamic_cast<ASTInt *>(call->args[i].get());
+					if(lane == nullptr || lane->value >= vector->lanes * first)
+						return {true, nullptr};
+				}
+				return remember(call, {false, makePtr<TypeVector>(vector->element,
+				                                                 std::uint32_t(count))});
+			}
+
+			bool bitwise = call->builtin == Builtin::reduceAnd
+			            || call->builtin == Builtin::reduceOr
+			            || call->builtin == Builtin::reduceXor;
+			if(call->args.size() != 1 || (bitwise && isFloatingNumericType(vector->element)))
+				return {true, nullptr};
+			return remember(call, {false, makePtr<TypeNumeric>(vector->element)});
+		}
+
+		void printAttributes(std::ostream &out, const std::vector<Attribute> &attributes)
+		{
+			for(const auto &a : attributes)
+			{
+				out << "@" << a.name;
+				for(std::size_t i = 0; i < a.args.size(); ++i)
+					out << (i == 0 ? "(" : ", ") << a.args[i];
+				out << (a.args.empty() ? " " : ") ");
+			}
+		}
+
+		auto isSameVariable(const Ptr<AST> &a, const Ptr<AST> &b) -> bool
+		{
+			auto x = dynamic_cast<ASTIdn *>(a.get()), y = dynamic_cast<ASTIdn *>(b.get());
+			return x != nullptr && y != nullptr && x->name == y->name;
+		}
+
+		auto isBareLiteral(const Ptr<AST> &node) -> bool
+		{
+			auto n = dynamic_cast<ASTInt *>(node.get());
+			auto f = dynamic_cast<ASTFloat *>(node.get());
+			return (n != nullptr && !n->suffixed) || (f != nullptr && !f->suffixed);
+		}
+
+		// Infers the type parameters of `generic` from the arguments of `call` and
+		// gets the instance for them. The types of the arguments are left in `types`.
+		auto instantiateCall(const ASTCall *call, const ASTFunc &generic, TypecheckEnv &env,
+		                     std::vector<Ptr<Type>> &types) -> const ASTFunc *
+		{
+			const auto &decl = generic.decl;
+			if(call->args.size() != decl.argNames.size())
+				return nullptr;
+
+			for(const auto &a : call->args)
+			{
+				auto t = a->type(env);
+				if(t.error)
+					return nullptr;
+				types.push_back(t.value);
+			}
+
+			// A bare literal binds only what the other arguments leave free, so that
+			// `max(x, 0)` with an i64 `x` is `max<i64>`.
+			TypeBindings bindings;
+			for(bool literals : {false, true})
+				for(std::size_t i = 0; i < types.size(); ++i)
+					if(isBareLiteral(call->args[i]) == literals)
+						bindTypeParameters(decl.signature.argTypes[i], types[i], bindings);
+
+			for(const auto &p : decl.typeParams)
+			{
+				auto b = bindings.find(p->name);
+				if(b == bindings.end() || !satisfiesConstraint(b->second, p->constraint))
+					return nullptr;
+			}
+			return env.instantiate(generic, bindings);
+		}
+	} // namespace
+
 	auto TypecheckEnv::has(const std::string &name) -> bool
 	{
 		return !it_(name).error;
@@ -18,30 +362,273 @@ namespace noct
 
 	void TypecheckEnv::set(const std::string &name, Ptr<Type> t)
 	{
-		if(has(name))
+		if(scopes.back().count(name) != 0)
 			return;
-		values[name] = t;
+		scopes.back()[name] = t;
+	}
+
+	void TypecheckEnv::erase(const std::string &name)
+	{
+		scopes.back().erase(name);
+	}
+
+	auto TypecheckEnv::isGlobal(const std::string &name) -> bool
+	{
+		auto r = it_(name);
+		return !r.error && scopes.front().find(name) == r.value;
+	}
+
+	void TypecheckEnv::enterScope()
+	{
+		scopes.emplace_back();
+	}
+
+	void TypecheckEnv::exitScope()
+	{
+		scopes.pop_back();
+	}
+
+	auto TypecheckEnv::enterParallel() -> std::size_t
+	{
+		scopes.emplace_back();
+		return std::exchange(parallelScope, scopes.size() - 1);
+	}
+
+	void TypecheckEnv::exitParallel(std::size_t outer)
+	{
+		scopes.pop_back();
+		parallelScope = outer;
+	}
+
+	auto TypecheckEnv::isShared(const std::string &name) -> bool
+	{
+		for(auto i = scopes.size(); i-- > parallelScope + 1;)
+			if(scopes[i].count(name) != 0)
+				return false;
+		return parallelScope != 0 && has(name);
+	}
+
+	void TypecheckEnv::declareGeneric(const ASTFunc *f)
+	{
+		generics.try_emplace(f->decl.name, f);
+	}
+
+	auto TypecheckEnv::getGeneric(const std::string &name) -> const ASTFunc *
+	{
+		// A variable of the same name hides it, like it hides any function.
+		auto g = generics.find(name);
+		if(g == generics.end() || has(name))
+			return nullptr;
+		return g->second;
+	}
+
+	auto TypecheckEnv::instantiate(const ASTFunc &generic, const TypeBindings &bindings)
+	    -> const ASTFunc *
+	{
+		auto name = getInstanceName(generic.decl, bindings);
+		if(auto i = instanceCache.find(name); i != instanceCache.end())
+			return i->second.get();
+
+		// Cached before it is checked, so that a recursive call finds it.
+		auto instance = instantiateFunction(generic, bindings);
+		instanceCache[name] = instance;
+		if(instance == nullptr)
+			return nullptr;
+
+		// Checked where the generic function stands, away from the caller's locals.
+		std::vector<MapType> locals(std::make_move_iterator(scopes.begin() + 1),
+		                            std::make_move_iterator(scopes.end()));
+		scopes.resize(1);
+		auto callerPurity = purity;
+		auto callerParallel = std::exchange(parallelScope, 0);
+		auto t = instance->type(*this);
+		purity = callerPurity;
+		parallelScope = callerParallel;
+		scopes.insert(scopes.end(), std::make_move_iterator(locals.begin()),
+		              std::make_move_iterator(locals.end()));
+
+		if(t.error)
+		{
+			instanceCache[name] = nullptr;
+			return nullptr;
+		}
+		instances.push_back(instance);
+		return instance.get();
+	}
+
+	auto TypecheckEnv::takeInstances() -> std::vector<Ptr<AST>>
+	{
+		return std::exchange(instances, {});
 	}
 
 	auto TypecheckEnv::it_(const std::string &name) -> Result<MapType::iterator>
 	{
-		auto i = values.find(name);
-		return {i == values.end(), i};
+		for(auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope)
+			if(auto i = scope->find(name); i != scope->end())
+				return {false, i};
+		return {true, scopes.front().end()};
+	}
+
+	auto FuncDeclaration::hasAttribute(const std::string &attr) const -> bool
+	{
+		for(const auto &a : attributes)
+			if(a.name == attr)
+				return true;
+		return false;
+	}
+
+	auto getFastMathFlags(const std::vector<Attribute> &attributes) -> std::optional<std::uint8_t>
+	{
+		constexpr std::pair<std::string_view, std::uint8_t> names[] = {
+			{ "reassoc", FastMath::reassoc }, { "contract", FastMath::contract },
+			{ "nnan", FastMath::nnan },       { "ninf", FastMath::ninf },
+			{ "nsz", FastMath::nsz },         { "arcp", FastMath::arcp },
+			{ "afn", FastMath::afn },         { "fast", FastMath::all },
+		};
+
+		std::uint8_t flags = 0;
+		for(const auto &a : attributes)
+		{
+			if(a.name != "fastmath")
+				continue;
+			if(a.args.empty())
+				flags |= FastMath::all;
+			for(const auto &arg : a.args)
+			{
+				auto n = std::find_if(std::begin(names), std::end(names),
+				                      [&](const auto &n) { return n.first == arg; });
+				if(n == std::end(names))
+					return std::nullopt;
+				flags |= n->second;
+			}
+		}
+		return flags;
+	}
+
+	auto FuncDeclaration::purity() const -> Purity
+	{
+		if(hasAttribute("const"))
+			return Purity::constant;
+		if(hasAttribute("pure"))
+			return Purity::pure;
+		return Purity::impure;
 	}
 
 	TypeRes ASTFunc::type(TypecheckEnv &env) const noexcept
 	{
+		// Only @fastmath takes arguments.
+		constexpr std::string_view known[] = {
+			"inline", "noinline", "always_inline", "hot", "cold",
+			"flatten", "pure", "const", "comptime", "fastmath",
+		};
+		for(const auto &a : decl.attributes)
+			if(std::find(std::begin(known), std::end(known), a.name) == std::end(known)
+			   || (a.name != "fastmath" && !a.args.empty()))
+				return {true, nullptr};
+
+		// Claims that contradict each other.
+		auto has = [&](const char *a) { return decl.hasAttribute(a); };
+		if((has("noinline") && (has("inline") || has("always_inline")))
+		   || (has("hot") && has("cold")) || (has("pure") && has("const"))
+		   || !getFastMathFlags(decl.attributes))
+			return {true, nullptr};
+
+		// An array lives in the frame of the function that declares it; it goes in
+		// and out of functions as a slice.
+		// So does a struct, as a slice of one or more.
+		auto inPlace = [](const Ptr<Type> &t) {
+			return dynamic_cast<TypeArray *>(t.get()) != nullptr
+			    || dynamic_cast<TypeStruct *>(t.get()) != nullptr;
+		};
+		for(const auto &t : decl.signature.argTypes)
+			if(inPlace(t))
+				return {true, nullptr};
+		if(inPlace(decl.signature.returnType))
+			return {true, nullptr};
+
+		if(!decl.typeParams.empty())
+			return typeGeneric(env);
+		if(env.getGeneric(decl.name) != nullptr)
+			return {true, nullptr};
+
+		// Declared before the body is checked, so that it can call itself.
+		env.set(decl.name, makePtr<TypeFunction>(decl.signature, decl.purity()));
+
+		env.enterScope();
+		for(std::size_t i = 0; i < decl.argNames.size(); ++i)
+			env.set(decl.argNames[i], decl.signature.argTypes[i]);
+		env.purity = decl.purity();
 		auto t = body->type(env);
+		env.purity = Purity::impure;
+		env.exitScope();
+
 		if(t.error)
 			return t;
 
-		return {!decl.signature.returnType->assignable(t.value),
-		        decl.signature.returnType};
+		return remember(this, {!decl.signature.returnType->assignable(t.value),
+		                       decl.signature.returnType});
+	}
+
+	// Only the signature is checked here; the body is checked for each instance.
+	// Every parameter has to be inferable from the arguments.
+	TypeRes ASTFunc::typeGeneric(TypecheckEnv &env) const noexcept
+	{
+		if(env.has(decl.name) || env.getGeneric(decl.name) != nullptr)
+			return {true, nullptr};
+
+		for(std::size_t i = 0; i < decl.typeParams.size(); ++i)
+		{
+			const auto &p = decl.typeParams[i];
+			for(std::size_t j = 0; j < i; ++j)
+				if(decl.typeParams[j]->name == p->name)
+					return {true, nullptr};
+
+			// Substitution fails without a binding for `p` only where `p` appears.
+			TypeBindings probe;
+			for(const auto &q : decl.typeParams)
+				if(q != p)
+					probe.emplace(q->name, q);
+			bool inferable = false;
+			for(const auto &t : decl.signature.argTypes)
+				if(substituteTypeParameters(t, probe) == nullptr)
+					inferable = true;
+			if(!inferable)
+				return {true, nullptr};
+		}
+
+		env.declareGeneric(this);
+		return remember(this, {false, decl.signature.returnType});
 	}
 
 	void ASTFunc::print(std::ostream &out, int indent) const noexcept
 	{
-		out << Indent(indent) << "fn " << decl.name << " -> ";
+		out << Indent(indent) << (decl.exported ? "pub " : "");
+		printAttributes(out, decl.attributes);
+
+		out << "fn " << decl.name;
+		if(!decl.typeParams.empty())
+		{
+			out << "<";
+			for(std::size_t i = 0; i < decl.typeParams.size(); ++i)
+			{
+				out << (i == 0 ? "" : ", ");
+				decl.typeParams[i]->print(out);
+				if(decl.typeParams[i]->constraint != TypeConstraint::any)
+					out << ": " << getTypeConstraintName(decl.typeParams[i]->constraint);
+			}
+			out << ">";
+		}
+		if(!decl.argNames.empty())
+		{
+			out << "(";
+			for(std::size_t i = 0; i < decl.argNames.size(); ++i)
+			{
+				out << (i == 0 ? "" : ", ") << decl.argNames[i] << ": ";
+				decl.signature.argTypes[i]->print(out);
+			}
+			out << ")";
+		}
+		out << " -> ";
 		decl.signature.returnType->print(out);
 		if(body != nullptr)
 		{
@@ -50,16 +637,42 @@ namespace noct
 		}
 	}
 
+	auto ASTBlock::isCold() const -> bool
+	{
+		for(const auto &a : attributes)
+			if(a.name == "cold")
+				return true;
+		return false;
+	}
+
 	TypeRes ASTBlock::type(TypecheckEnv &env) const noexcept
 	{
+		for(const auto &a : attributes)
+			if(a.name != "fastmath" && !(a.name == "cold" && a.args.empty()))
+				return {true, nullptr};
+		if(!getFastMathFlags(attributes))
+			return {true, nullptr};
+
 		if(nodes.size() == 0)
-			return TypeRes{false, nullptr};
-		return nodes.back()->type(env);
+			return remember(this, {false, makePtr<TypeUnit>()});
+
+		env.enterScope();
+		TypeRes t{true, nullptr};
+		for(const auto &node : nodes)
+			if((t = node->type(env)).error)
+				break;
+		env.exitScope();
+
+		if(t.error)
+			return {true, nullptr};
+		return remember(this, t);
 	}
 
 	void ASTBlock::print(std::ostream &out, int indent) const noexcept
 	{
-		out << Indent(indent) << "{\n";
+		out << Indent(indent);
+		printAttributes(out, attributes);
+		out << "{\n";
 
 		for(const auto &node : nodes)
 		{
@@ -69,32 +682,40 @@ namespace noct
 		out << Indent(indent) << "}\n";
 	}
 
-	TypeRes ASTInt::type(TypecheckEnv &env) const noexcept
+	TypeRes ASTInt::type(TypecheckEnv &) const noexcept
 	{
-		return {false,
-		        Ptr<TypeNumeric>(new TypeNumeric(getSuitableIntegerTypeFor(value)))};
+		return remember(this, {false, Ptr<TypeNumeric>(new TypeNumeric(numeric))});
 	}
 
 	void ASTInt::print(std::ostream &out, int indent) const noexcept
 	{
-		out << Indent(indent) << getNumericTypeName(getSuitableIntegerTypeFor(value))
-		    << " " << value;
+		out << Indent(indent) << getNumericTypeName(numeric) << " " << value;
+	}
+
+	TypeRes ASTFloat::type(TypecheckEnv &) const noexcept
+	{
+		return remember(this, {false, makePtr<TypeNumeric>(numeric)});
+	}
+
+	void ASTFloat::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << getNumericTypeName(numeric) << " " << value;
 	}
 
 	TypeRes ASTVar::type(TypecheckEnv &env) const noexcept
 	{
 		if(value != nullptr)
 		{
-			if(auto v = value->type(env); !v.error && !decl.type->assignable(v.value))
+			if(auto v = value->type(env); v.error || !acceptsElement(decl.type, value, v.value))
 				return {true, nullptr};
 		}
 		env.set(decl.name, decl.type);
-		return {false, decl.type};
+		return remember(this, {false, decl.type});
 	}
 
 	void ASTVar::print(std::ostream &out, int indent) const noexcept
 	{
-		out << Indent(indent) << "let " << decl.name << ": ";
+		out << Indent(indent) << (decl.exported ? "pub let " : "let ") << decl.name << ": ";
 		decl.type->print(out);
 		if(value != nullptr)
 		{
@@ -107,7 +728,12 @@ namespace noct
 	TypeRes ASTIdn::type(TypecheckEnv &env) const noexcept
 	{
 		if(auto t = env.get(name); t != nullptr)
-			return {false, t};
+		{
+			// Globals are memory, which a @const function does not read.
+			if(env.purity == Purity::constant && env.isGlobal(name))
+				return {true, nullptr};
+			return remember(this, {false, t});
+		}
 		else
 			return {true, nullptr};
 	}
@@ -116,4 +742,432 @@ namespace noct
 	{
 		out << Indent(indent) << name;
 	}
+
+	TypeRes ASTStruct::type(TypecheckEnv &) const noexcept
+	{
+		for(const auto &a : attributes)
+		{
+			if(a.name == "repr" && a.args.size() == 1 && a.args[0] == "C")
+				decl->reprC = true;
+			else if(a.name == "packed" && a.args.empty())
+				decl->packed = true;
+			else if(a.name == "align" && a.args.size() == 1)
+			{
+				auto n = parseIntegerLiteral(a.args[0]);
+				if(n.error != nullptr || !std::has_single_bit(n.value) || n.value > 4096)
+					return {true, nullptr};
+				decl->minAlignment = n.value;
+			}
+			else
+				return {true, nullptr};
+		}
+
+		if(decl->fields.empty())
+			return {true, nullptr};
+		for(std::size_t i = 0; i < decl->fields.size(); ++i)
+		{
+			const auto &f = decl->fields[i];
+			if(!isValueType(f.type) || decl->getField(f.name) != i)
+				return {true, nullptr};
+		}
+
+		decl->layOut();
+		return remember(this, {false, makePtr<TypeUnit>()});
+	}
+
+	void ASTStruct::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent);
+		printAttributes(out, attributes);
+		out << "struct " << decl->name << " { ";
+		for(std::size_t i = 0; i < decl->fields.size(); ++i)
+		{
+			out << (i == 0 ? "" : ", ") << decl->fields[i].name << ": ";
+			decl->fields[i].type->print(out);
+		}
+		out << " }";
+	}
+
+	TypeRes ASTAssign::type(TypecheckEnv &env) const noexcept
+	{
+		auto target = env.get(name);
+		if(target == nullptr || target->type == TypeType::function)
+			return {true, nullptr};
+
+		// A @pure or @const function writes its locals only, and of memory, only its
+		// own arrays.
+		if(env.purity != Purity::impure
+		   && (env.isGlobal(name) || (index != nullptr && target->type == TypeType::structural
+		                              && dynamic_cast<TypeArray *>(target.get()) == nullptr)))
+			return {true, nullptr};
+
+		// Iterations of a parallel loop may run at once, and each has its own copy
+		// of a local around it: only what is in memory is written from there. The
+		// loop variable is shared too, to keep it from being written.
+		if(env.isShared(name) && field.empty()
+		   && (index == nullptr || target->type != TypeType::structural))
+			return {true, nullptr};
+
+		this->target = target;
+		if(!field.empty())
+		{
+			// `p.f = x` or `a[i].f = x`.
+			auto s = index != nullptr ? getStructElement(target)
+			                          : dynamic_cast<TypeStruct *>(target.get());
+			auto f = s != nullptr ? s->getField(field) : std::nullopt;
+			if(auto q = getPointerQualifiers(target); f == std::nullopt || (q && q->readonly))
+				return {true, nullptr};
+
+			if(index != nullptr)
+				if(auto i = numericOf(index->type(env));
+				   i == NumericType::unknown || isFloatingNumericType(i))
+					return {true, nullptr};
+
+			const auto &t = s->fields[*f].type;
+			if(auto v = value->type(env); v.error || !acceptsElement(t, value, v.value))
+				return {true, nullptr};
+			fieldIndex = *f;
+			return remember(this, {false, t});
+		}
+
+		if(index != nullptr)
+		{
+			if(auto q = getPointerQualifiers(target); q != nullptr && q->readonly)
+				return {true, nullptr};
+
+			auto element = getIndexedType(target);
+			auto i = numericOf(index->type(env));
+			auto v = value->type(env);
+			if(element == nullptr || i == NumericType::unknown || isFloatingNumericType(i)
+			   || v.error || !acceptsElement(element, value, v.value))
+				return {true, nullptr};
+			return remember(this, {false, element});
+		}
+
+		if(auto v = value->type(env); v.error || !acceptsElement(target, value, v.value))
+			return {true, nullptr};
+		return remember(this, {false, target});
+	}
+
+	void ASTAssign::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << name;
+		if(index != nullptr)
+		{
+			out << "[";
+			index->print(out, 0);
+			out << "]";
+		}
+		if(!field.empty())
+			out << "." << field;
+		out << " = ";
+		value->print(out, 0);
+	}
+
+	TypeRes ASTIndex::type(TypecheckEnv &env) const noexcept
+	{
+		// A struct is only ever used a field at a time.
+		auto t = typeElement(env);
+		if(t.error || dynamic_cast<TypeStruct *>(t.value.get()) != nullptr)
+			return {true, nullptr};
+		return t;
+	}
+
+	TypeRes ASTIndex::typeElement(TypecheckEnv &env) const noexcept
+	{
+		// What a slice points to is memory, which a @const function does not read; its
+		// own arrays are only values.
+		auto b = base->type(env);
+		if(!b.error && env.purity == Purity::constant && dynamic_cast<TypeSlice *>(b.value.get()))
+			return {true, nullptr};
+
+		auto element = b.error ? nullptr : getIndexedType(b.value);
+		auto i = numericOf(index->type(env));
+		if(element == nullptr || i == NumericType::unknown || isFloatingNumericType(i))
+			return {true, nullptr};
+		return remember(this, {false, element});
+	}
+
+	void ASTIndex::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent);
+		base->print(out, 0);
+		out << "[";
+		index->print(out, 0);
+		out << "]";
+	}
+
+	TypeRes ASTField::type(TypecheckEnv &env) const noexcept
+	{
+		TypeRes b{true, nullptr};
+		if(auto i = dynamic_cast<ASTIndex *>(base.get()); i != nullptr)
+			b = i->typeElement(env);
+		else if(dynamic_cast<ASTIdn *>(base.get()) != nullptr)
+			b = base->type(env);
+
+		auto s = b.error ? nullptr : dynamic_cast<TypeStruct *>(b.value.get());
+		auto f = s != nullptr ? s->getField(field) : std::nullopt;
+		if(f == std::nullopt)
+			return {true, nullptr};
+		fieldIndex = *f;
+		return remember(this, {false, s->fields[*f].type});
+	}
+
+	void ASTField::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent);
+		base->print(out, 0);
+		out << "." << field;
+	}
+
+	TypeRes ASTIf::type(TypecheckEnv &env) const noexcept
+	{
+		if(auto c = cond->type(env); c.error || c.value->type != TypeType::numeric)
+			return {true, nullptr};
+
+		auto t = then->type(env);
+		if(t.error)
+			return t;
+		if(otherwise == nullptr)
+			return remember(this, {false, makePtr<TypeUnit>()});
+
+		auto e = otherwise->type(env);
+		if(e.error)
+			return e;
+
+		// Without a value on both sides, the whole thing has none.
+		if(!isValueType(t.value) || !isValueType(e.value))
+			return remember(this, {false, makePtr<TypeUnit>()});
+		if(t.value->assignable(e.value))
+			return remember(this, t);
+		if(e.value->assignable(t.value))
+			return remember(this, e);
+		return {true, nullptr};
+	}
+
+	void ASTIf::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << "if ";
+		cond->print(out, 0);
+		out << "\n";
+		then->print(out, indent);
+		if(otherwise != nullptr)
+		{
+			out << Indent(indent) << "else\n";
+			otherwise->print(out, indent);
+		}
+	}
+
+	TypeRes ASTWhile::type(TypecheckEnv &env) const noexcept
+	{
+		if(auto c = cond->type(env); c.error || c.value->type != TypeType::numeric)
+			return {true, nullptr};
+		if(body->type(env).error)
+			return {true, nullptr};
+		return remember(this, {false, makePtr<TypeUnit>()});
+	}
+
+	void ASTWhile::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << "while ";
+		cond->print(out, 0);
+		out << "\n";
+		body->print(out, indent);
+	}
+
+	TypeRes ASTParallel::type(TypecheckEnv &env) const noexcept
+	{
+		// Threads are no business of a @pure or @const function.
+		if(env.purity != Purity::impure)
+			return {true, nullptr};
+
+		auto l = numericOf(lo->type(env));
+		auto h = numericOf(hi->type(env));
+		l = adaptLiteral(lo, l, h);
+		h = adaptLiteral(hi, h, l);
+		if(l == NumericType::unknown || h == NumericType::unknown
+		   || isFloatingNumericType(l) || isFloatingNumericType(h))
+			return {true, nullptr};
+		varType = makePtr<TypeNumeric>(getCommonNumericType(l, h));
+
+		auto outer = env.enterParallel();
+		env.set(var, varType);
+		auto b = body->type(env);
+		env.exitParallel(outer);
+		if(b.error)
+			return {true, nullptr};
+		if(op == 0)
+			return remember(this, {false, makePtr<TypeUnit>()});
+
+		auto vector = dynamic_cast<TypeVector *>(b.value.get());
+		auto element = vector != nullptr ? vector->element : numericOf(b);
+		if(element == NumericType::unknown || isFloatingNumericType(element))
+			return {true, nullptr};
+		return remember(this, b);
+	}
+
+	void ASTParallel::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << "parallel ";
+		if(op == 0)
+			out << "for ";
+		else
+			out << "reduce(" << op << ") ";
+		out << var << " in ";
+		lo->print(out, 0);
+		out << "..";
+		hi->print(out, 0);
+		out << "\n";
+		body->print(out, indent);
+	}
+
+	TypeRes ASTBinary::type(TypecheckEnv &env) const noexcept
+	{
+		auto lt = lhs->type(env);
+		auto rt = rhs->type(env);
+		if(lt.error || rt.error)
+			return {true, nullptr};
+
+		// Element-wise, with a scalar operand broadcast to every lane.
+		auto lv = std::dynamic_pointer_cast<TypeVector>(lt.value);
+		auto rv = std::dynamic_pointer_cast<TypeVector>(rt.value);
+		if(lv != nullptr || rv != nullptr)
+		{
+			auto vector = lv != nullptr ? lv : rv;
+			bool matches = lv != nullptr && rv != nullptr
+			                   ? lv->assignable(rv)
+			                   : lv != nullptr ? acceptsScalar(lv->element, rhs, rt.value)
+			                                   : acceptsScalar(rv->element, lhs, lt.value);
+			if(!matches || op == TokenType::opr_d_amp || op == TokenType::opr_d_bar
+			   || (isFloatingNumericType(vector->element) && isIntegerOnly(op)))
+				return {true, nullptr};
+
+			operandType = vector;
+			if(isComparison(op))
+				return remember(this, {false, makePtr<TypeVector>(
+				                                  getMaskNumericType(vector->element),
+				                                  vector->lanes)});
+			return remember(this, {false, vector});
+		}
+
+		auto l = numericOf(lt);
+		auto r = numericOf(rt);
+		if(l == NumericType::unknown || r == NumericType::unknown)
+			return {true, nullptr};
+
+		// Logical operators only test their operands; comparisons yield 0 or 1, as in C.
+		if(op == TokenType::opr_d_amp || op == TokenType::opr_d_bar)
+			return remember(this, {false, makePtr<TypeNumeric>(NumericType::i32)});
+
+		l = adaptLiteral(lhs, l, r);
+		r = adaptLiteral(rhs, r, l);
+
+		// A shift has the type of what is shifted; a shifted literal, that of the
+		// literal it stands for. A constant amount has to be less than the width.
+		bool shift = op == TokenType::opr_shftl || op == TokenType::opr_shftr;
+		auto common = shift ? l : getCommonNumericType(l, r);
+		if(auto v = getShiftedLiteral(this); v.has_value())
+			common = getSuitableIntegerTypeFor(*v);
+		if(isFloatingNumericType(common) && isIntegerOnly(op))
+			return {true, nullptr};
+		if(auto amount = dynamic_cast<ASTInt *>(rhs.get());
+		   shift && amount != nullptr && amount->value >= getNumericTypeWidth(common) * 8u)
+			return {true, nullptr};
+		operandType = makePtr<TypeNumeric>(common);
+
+		if(isComparison(op))
+			return remember(this, {false, makePtr<TypeNumeric>(NumericType::i32)});
+		return remember(this, {false, operandType});
+	}
+
+	void ASTBinary::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << "(";
+		lhs->print(out, 0);
+		out << " ";
+		printOperator(out, op);
+		out << " ";
+		rhs->print(out, 0);
+		out << ")";
+	}
+
+	TypeRes ASTUnary::type(TypecheckEnv &env) const noexcept
+	{
+		auto t = operand->type(env);
+		auto vector = dynamic_cast<TypeVector *>(t.value.get());
+		auto element = vector != nullptr ? vector->element : numericOf(t);
+		if(t.error || element == NumericType::unknown)
+			return {true, nullptr};
+
+		if(op == '~' && isFloatingNumericType(element))
+			return {true, nullptr};
+		if(op == '!' && vector != nullptr)
+			return {true, nullptr};
+		if(op == '!')
+			return remember(this, {false, makePtr<TypeNumeric>(NumericType::i32)});
+		return remember(this, t);
+	}
+
+	void ASTUnary::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << op;
+		operand->print(out, 0);
+	}
+
+	TypeRes ASTCall::type(TypecheckEnv &env) const noexcept
+	{
+		// A generic call is resolved to its instance, and from there on it is an
+		// ordinary call. The name it was written with stays for the next check.
+		std::vector<Ptr<Type>> types;
+		if(auto g = env.getGeneric(generic.empty() ? name : generic); g != nullptr)
+		{
+			auto instance = instantiateCall(this, *g, env, types);
+			if(instance == nullptr)
+				return {true, nullptr};
+			generic = g->decl.name;
+			name = instance->decl.name;
+		}
+
+		callee = std::dynamic_pointer_cast<TypeFunction>(env.get(name));
+		if(callee == nullptr)
+			return typeBuiltin(this, env);
+
+		const auto &signature = callee->signature;
+		if(args.size() != signature.argTypes.size() || callee->purity < env.purity)
+			return {true, nullptr};
+
+		for(std::size_t i = 0; i < args.size(); ++i)
+		{
+			auto t = i < types.size() ? TypeRes{false, types[i]} : args[i]->type(env);
+			if(t.error || !acceptsElement(signature.argTypes[i], args[i], t.value))
+				return {true, nullptr};
+		}
+
+		// The same variable going to a restrict parameter and to another one breaks
+		// the promise, unless neither is written through. Aliasing that is not this
+		// obvious is on the caller, as in C.
+		for(std::size_t i = 0; i < args.size(); ++i)
+			for(std::size_t j = i + 1; j < args.size(); ++j)
+			{
+				auto qi = getPointerQualifiers(signature.argTypes[i]);
+				auto qj = getPointerQualifiers(signature.argTypes[j]);
+				if(qi != nullptr && qj != nullptr && (qi->restrict || qj->restrict)
+				   && !(qi->readonly && qj->readonly) && isSameVariable(args[i], args[j]))
+					return {true, nullptr};
+			}
+
+		return remember(this, {false, signature.returnType});
+	}
+
+	void ASTCall::print(std::ostream &out, int indent) const noexcept
+	{
+		out << Indent(indent) << (generic.empty() ? name : generic) << "(";
+		for(std::size_t i = 0; i < args.size(); ++i)
+		{
+			if(i != 0)
+				out << ", ";
+			args[i]->print(out, 0);
+		}
+		out << ")";
+	}
 } // namespace noct
@@ -1,7 +1,10 @@
 #pragma once
 #include "util.hpp"
 #include "types.hpp"
+#include "token.hpp"
 
+#include <cstdint>
+#include <optional>
 #include <unordered_map>
 #include <iostream>
 #include <string>
@@ -9,30 +12,104 @@
 
 namespace noct
 {
+	struct AST;
+	struct ASTFunc;
+
 	class TypecheckEnv
 	{
 	public:
+		TypecheckEnv() : scopes(1) {}
+
 		auto has(const std::string &name) -> bool;
 		auto get(const std::string &name) -> Ptr<Type>;
 		void set(const std::string &name, Ptr<Type> t);
+		void erase(const std::string &name); // from the innermost scope
+
+		// Found in the outermost scope, and not shadowed by a local.
+		auto isGlobal(const std::string &name) -> bool;
+
+		void enterScope();
+		void exitScope();
+
+		// The body of a parallel loop gets a scope of its own, holding the loop
+		// variable. Anything declared outside it is shared between iterations that
+		// may run at once. enterParallel returns what exitParallel restores.
+		auto enterParallel() -> std::size_t;
+		void exitParallel(std::size_t outer);
+		auto isShared(const std::string &name) -> bool;
+
+		// Claimed by the function being checked; its body is held to it.
+		Purity purity = Purity::impure;
+
+		// A generic function is checked only as instances: the first call with a
+		// given list of types makes a function of its own, named like `max<i32>`,
+		// and checks it as if it stood at the top level. Later calls share it.
+		void declareGeneric(const ASTFunc *f);
+		auto getGeneric(const std::string &name) -> const ASTFunc *;
+		auto instantiate(const ASTFunc &generic, const TypeBindings &bindings)
+		    -> const ASTFunc *;
+
+		// The instances made since the last call, to be generated like the rest.
+		auto takeInstances() -> std::vector<Ptr<AST>>;
 
 	private:
 		using MapType = std::unordered_map<std::string, Ptr<Type>>;
 		auto it_(const std::string &name) -> Result<MapType::iterator>;
-		MapType values;
+		std::vector<MapType> scopes;
+		std::size_t parallelScope = 0; // of the innermost parallel loop, 0 outside one
+
+		std::unordered_map<std::string, const ASTFunc *> generics;
+		std::unordered_map<std::string, Ptr<ASTFunc>>    instanceCache; // null if it failed
+		std::vector<Ptr<AST>>                            instances;
+	};
+
+	struct Attribute
+	{
+		std::string name;
+		std::vector<std::string> args;
 	};
 
+	// What @fastmath(...) lets the optimizer assume about floating point in the
+	// code it covers, one bit per LLVM fast-math flag. Without arguments it is all
+	// of them.
+	namespace FastMath
+	{
+		enum : std::uint8_t
+		{
+			reassoc  = 1 << 0,
+			contract = 1 << 1,
+			nnan     = 1 << 2,
+			ninf     = 1 << 3,
+			nsz      = 1 << 4,
+			arcp     = 1 << 5,
+			afn      = 1 << 6,
+			all      = (1 << 7) - 1,
+		};
+	}
+
+	// 0 without @fastmath; nullopt when it names a flag that does not exist.
+	auto getFastMathFlags(const std::vector<Attribute> &attributes) -> std::optional<std::uint8_t>;
+
 	struct FuncDeclaration
 	{
 		FuncSignature signature;
 		std::string name;
 		std::vector<std::string> argNames;
+		std::vector<Attribute> attributes;
+		std::vector<Ptr<TypeParameter>> typeParams; // `fn max<T: numeric>`
+		bool exported = false;
+
+		auto hasAttribute(const std::string &attr) const -> bool;
+		auto purity() const -> Purity;
 	};
 
 	struct VarDeclaration
 	{
 		Ptr<Type> type;
 		std::string name;
+		bool exported = false;
+		bool constant = false; // nothing can write to it
+		bool local = false;
 	};
 
 	using TypeRes = Result<Ptr<Type>>;
@@ -42,6 +119,7 @@ namespace noct
 	struct AST
 	{
 		Ptr<struct ASTImpl> impl_;
+		mutable Ptr<Type> checkedType; // what type() last resolved this node to
 
 		virtual TypeRes type(TypecheckEnv &env) const noexcept = 0;
 		virtual void print(std::ostream &out, int indent) const noexcept = 0;
@@ -71,6 +149,17 @@ namespace noct
 		FuncDeclaration decl;
 		Ptr<AST> body;
 
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		TypeRes typeGeneric(TypecheckEnv &env) const noexcept;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	// `struct Name { field: type, ... }`; its attributes lay it out.
+	struct ASTStruct : AST
+	{
+		Ptr<TypeStruct> decl;
+		std::vector<Attribute> attributes; // @repr(C), @packed, @align(N)
+
 		TypeRes type(TypecheckEnv &env) const noexcept override;
 		void print(std::ostream &out, int indent) const noexcept override;
 	};
@@ -78,6 +167,143 @@ namespace noct
 	struct ASTBlock : AST
 	{
 		std::vector<Ptr<AST>> nodes;
+		std::vector<Attribute> attributes; // `@fastmath { ... }`, `@cold { ... }`
+
+		// Expected to run rarely: branches into it are weighted against it.
+		auto isCold() const -> bool;
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	// What a call that names no function in scope may be instead. These are
+	// generated inline.
+	enum class Builtin
+	{
+		none,
+		vector,  // i32x4(a, b, c, d), or i32x4(a) for the same value in every lane
+		shuffle, // shuffle(a, [b,] lane...): numbers lanes of a, then those of b
+		len,     // len(a): how many elements an array or slice has, as a u64
+		reduceAdd, reduceMul, reduceMin, reduceMax,
+		reduceAnd, reduceOr, reduceXor,
+		likely, unlikely, // likely(c): c != 0, as 0 or 1, for a branch that usually takes it
+	};
+
+	struct ASTCall : AST
+	{
+		mutable std::string name;    // a call to a generic function ends up naming the instance
+		mutable std::string generic; // and then the generic function is kept here
+		std::vector<Ptr<AST>> args;
+		mutable Ptr<TypeFunction> callee;
+		mutable Builtin builtin = Builtin::none;
+
+		ASTCall(std::string name) : name(std::move(name)) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTAssign : AST
+	{
+		std::string name;
+		Ptr<AST> index; // may be null; `v[i] = x` writes a single lane or element
+		std::string field; // may be empty; `p.f = x` or `a[i].f = x` writes a field
+		Ptr<AST> value;
+		mutable std::size_t fieldIndex = 0;
+		mutable Ptr<Type> target; // the variable's type
+		bool boundsChecked = true;
+
+		ASTAssign(std::string name) : name(std::move(name)) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	// A lane of a vector, or an element of an array or slice. A lane index wraps
+	// around the lane count, so that it can never be out of range; an element
+	// index is checked, unless eliminateBoundsChecks has proven it in range.
+	struct ASTIndex : AST
+	{
+		Ptr<AST> base, index;
+		bool boundsChecked = true;
+
+		ASTIndex(Ptr<AST> base, Ptr<AST> index)
+			: base(std::move(base)), index(std::move(index)) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		TypeRes typeElement(TypecheckEnv &env) const noexcept; // a struct too
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	// `p.f` or `a[i].f`: a field of a struct variable, or of an element of an
+	// array or slice of structs. A struct is never a value of its own.
+	struct ASTField : AST
+	{
+		Ptr<AST> base;
+		std::string field;
+		mutable std::size_t fieldIndex = 0;
+
+		ASTField(Ptr<AST> base, std::string field)
+			: base(std::move(base)), field(std::move(field)) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTIf : AST
+	{
+		Ptr<AST> cond;
+		Ptr<AST> then;
+		Ptr<AST> otherwise; // may be null
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTWhile : AST
+	{
+		Ptr<AST> cond;
+		Ptr<AST> body;
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	// `parallel for i in lo..hi { ... }` runs the body for every i in [lo, hi), in
+	// no particular order and on as many threads as there are. `parallel reduce(op)`
+	// also combines the values of the body with op, one of + * & | ^ on integers,
+	// whose order does not matter. The body only reads the variables around it,
+	// and writes to them an element or a field at a time.
+	struct ASTParallel : AST
+	{
+		std::string var;
+		Ptr<AST> lo, hi, body;
+		char op = 0; // 0 for `parallel for`
+		mutable Ptr<Type> varType; // of the loop variable
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTBinary : AST
+	{
+		char op; // a TokenType
+		Ptr<AST> lhs, rhs;
+		mutable Ptr<Type> operandType; // what both sides are converted to
+
+		ASTBinary(char op, Ptr<AST> lhs, Ptr<AST> rhs)
+			: op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTUnary : AST
+	{
+		char op;
+		Ptr<AST> operand;
+
+		ASTUnary(char op, Ptr<AST> operand) : op(op), operand(std::move(operand)) { }
 
 		TypeRes type(TypecheckEnv &env) const noexcept override;
 		void print(std::ostream &out, int indent) const noexcept override;
@@ -86,8 +312,26 @@ namespace noct
 	struct ASTInt : AST
 	{
 		std::size_t value;
+		NumericType numeric;  // decided once, when the literal is parsed
+		bool        suffixed; // `5u8` keeps its type; a bare `5` adapts to the other operand
+
+		ASTInt(std::size_t value)
+			: value(value), numeric(getSuitableIntegerTypeFor(value)), suffixed(false) { }
+		ASTInt(std::size_t value, NumericType numeric, bool suffixed = false)
+			: value(value), numeric(numeric), suffixed(suffixed) { }
+
+		TypeRes type(TypecheckEnv &env) const noexcept override;
+		void print(std::ostream &out, int indent) const noexcept override;
+	};
+
+	struct ASTFloat : AST
+	{
+		double      value;
+		NumericType numeric;
+		bool        suffixed; // `1.5f32` keeps its type; a bare `1.5` adapts to a float operand
 
-		ASTInt(std::size_t value) : value(value) { }
+		ASTFloat(double value, NumericType numeric, bool suffixed = false)
+			: value(value), numeric(numeric), suffixed(suffixed) { }
 
 		TypeRes type(TypecheckEnv &env) const noexcept override;
 		void print(std::ostream &out, int indent) const noexcept override;
@@ -0,0 +1,197 @@
+#include "synth.hpp"
+#include "../util.hpp"
+#include "../lexer.hpp"
+#include "../parser.hpp"
+#include "../analysis.hpp"
+#include "../codegen.hpp"
+#include "../generic.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Frontend throughput benchmark.
+//
+//   noct-bench [-f functions] [-g globals] [-d depth] [-s statements]
+//              [-x operators] [-l identifier length] [-r seed] [-n iterations]
+//              [-G generic helpers] [-M] [--emit]
+//
+// -x makes every statement an expression with that many binary operators, for
+// expression-heavy parser throughput. -G adds generic helpers, which every
+// function calls with arguments of random types; with -M they are written out
+// once per type instead, to compare against monomorphization by hand. --emit
+// prints the synthetic program instead of benchmarking it.
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	template<typename F>
+	auto measure(std::size_t iterations, F &&f) -> double
+	{
+		std::vector<double> samples;
+		for(std::size_t i = 0; i < iterations; ++i)
+		{
+			auto begin = Clock::now();
+			f();
+			samples.push_back(std::chrono::duration<double>(Clock::now() - begin).count());
+		}
+
+		// The median is a lot less noisy than the mean for tracking regressions.
+		std::sort(samples.begin(), samples.end());
+		return samples[samples.size() / 2];
+	}
+
+	auto countNodes(noct::AST *ast) -> std::size_t
+	{
+		if(ast == nullptr)
+			return 0;
+
+		std::size_t count = 1;
+		noct::forEachChild(ast, [&](noct::AST *c) { count += countNodes(c); });
+		return count;
+	}
+
+	auto parse(const std::string &source) -> std::vector<noct::Ptr<noct::AST>>
+	{
+		std::istringstream in(source);
+		auto               l = noct::Lexer{in};
+		auto               bl = noct::BufferedIterable<noct::Token, noct::Lexer>(l);
+		auto               it = bl.begin();
+		return noct::Parser().parseProgram(it);
+	}
+
+	void report(const char *phase, double seconds, std::size_t bytes, std::size_t items,
+	            const char *unit = "nodes")
+	{
+		if(bytes != 0)
+			std::printf("%-10s %10.3f ms %10.2f MB/s %14.0f %s/s\n", phase,
+			            seconds * 1e3, bytes / seconds / 1e6, items / seconds, unit);
+		else
+			std::printf("%-10s %10.3f ms %15s %14.0f %s/s\n", phase, seconds * 1e3, "-",
+			            items / seconds, unit);
+	}
+}
+
+auto main(int argc, char *argv[]) -> int
+{
+	noct::bench::SynthShape shape;
+	std::size_t             iterations = 10;
+	bool                    emit = false;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		auto number = [&]() -> std::size_t
+		{
+			if(i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << argv[i] << std::endl;
+				std::exit(1);
+			}
+			return std::stoull(argv[++i]);
+		};
+
+		if(std::strcmp(argv[i], "--emit") == 0)
+			emit = true;
+		else if(std::strcmp(argv[i], "-f") == 0)
+			shape.functions = number();
+		else if(std::strcmp(argv[i], "-g") == 0)
+			shape.globals = number();
+		else if(std::strcmp(argv[i], "-d") == 0)
+			shape.depth = number();
+		else if(std::strcmp(argv[i], "-s") == 0)
+			shape.statements = number();
+		else if(std::strcmp(argv[i], "-x") == 0)
+			shape.operators = number();
+		else if(std::strcmp(argv[i], "-l") == 0)
+			shape.identLength = number();
+		else if(std::strcmp(argv[i], "-r") == 0)
+			shape.seed = number();
+		else if(std::strcmp(argv[i], "-G") == 0)
+			shape.generics = number();
+		else if(std::strcmp(argv[i], "-M") == 0)
+			shape.monomorphic = true;
+		else if(std::strcmp(argv[i], "-n") == 0)
+			iterations = std::max<std::size_t>(number(), 1);
+		else
+		{
+			std::cerr << "unknown option " << argv[i] << std::endl;
+			return 1;
+		}
+	}
+
+	auto source = noct::bench::generateProgram(shape);
+	if(emit)
+	{
+		std::cout << source;
+		return 0;
+	}
+
+	auto        program = parse(source);
+	std::size_t nodes = 0;
+	for(const auto &n : program) nodes += countNodes(n.get());
+
+	std::size_t tokens = 0;
+	auto        lexTime = measure(iterations, [&]() {
+		std::istringstream in(source);
+		auto               l = noct::Lexer{in};
+		auto               it = l.begin();
+		tokens = 0;
+		while((*++it).type != noct::TokenType::eof) ++tokens;
+	});
+
+	auto parseTime = measure(iterations, [&]() { parse(source); });
+
+	// Checking annotates the tree and makes generic instances, so every run gets a
+	// fresh parse of its own. Parsing and freeing them stay outside the clock.
+	std::vector<std::vector<noct::Ptr<noct::AST>>> fresh(iterations), checked;
+	for(auto &p : fresh) p = parse(source);
+
+	bool typeError = false;
+	auto typeTime = measure(iterations, [&]() {
+		noct::TypecheckEnv env;
+		for(const auto &n : fresh.back()) typeError |= n->type(env).error;
+		checked.push_back(std::move(fresh.back()));
+		fresh.pop_back();
+	});
+	checked.clear();
+
+	// Code is generated for what the compiler would generate it for: the instances
+	// take the place of the generic functions.
+	noct::TypecheckEnv env;
+	for(const auto &n : program) n->type(env);
+	noct::monomorphize(program, env);
+	auto instances = std::count_if(program.begin(), program.end(), [](const auto &n) {
+		auto f = dynamic_cast<noct::ASTFunc *>(n.get());
+		return f != nullptr && f->decl.name.find('<') != std::string::npos;
+	});
+
+	auto genTime = measure(iterations, [&]() {
+		noct::Generator gen("bench");
+		for(const auto &n : program) gen.generate(n.get());
+	});
+
+	std::printf("shape: %zu functions, %zu globals, depth %zu, %zu statements, "
+	            "%zu operators, identifiers %zu chars, seed %u\n",
+	            shape.functions, shape.globals, shape.depth, shape.statements,
+	            shape.operators, shape.identLength, shape.seed);
+	std::printf("input: %zu bytes, %zu tokens, %zu nodes, %zu iterations (median)\n",
+	            source.size(), tokens, nodes, iterations);
+	if(shape.generics != 0)
+		std::printf("generics: %zu helpers%s, %zu instances\n", shape.generics,
+		            shape.monomorphic ? " copied per type" : "", std::size_t(instances));
+	if(typeError)
+		std::printf("warning: the synthetic program did not typecheck\n");
+
+	report("lexer", lexTime, source.size(), tokens, "tokens");
+	report("parser", parseTime, source.size(), nodes);
+	report("typecheck", typeTime, 0, nodes);
+	report("codegen", genTime, 0, nodes);
+
+	return 0;
+}
@@ -0,0 +1,24 @@
+#include <stddef.h>
+#include <stdint.h>
+
+static uint64_t data[4096];
+
+static uint64_t fill(uint64_t *s, size_t n, uint64_t seed)
+{
+	for(size_t i = 0; i < n; ++i) s[i] = seed * i;
+	return seed;
+}
+
+static uint64_t sum(const uint64_t *s, size_t n)
+{
+	uint64_t t = 0;
+	for(size_t i = 0; i < n; ++i) t = t + (s[i] ^ (s[i] >> 5));
+	return t;
+}
+
+int kernel(void)
+{
+	fill(data, 4096, 2654435761u);
+	uint64_t t = sum(data, 4096);
+	return t > 0 ? 1 : 0;
+}
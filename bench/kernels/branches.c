@@ -0,0 +1,38 @@
+#include <stddef.h>
+#include <stdint.h>
+
+static uint8_t  input[4096];
+static uint64_t errors;
+
+__attribute__((noinline)) static uint64_t reject(uint64_t at, uint8_t byte)
+{
+	(void)byte;
+	errors = errors + 1;
+	if(errors > 1000000)
+		errors = 0;
+	return at ^ errors;
+}
+
+static uint64_t parse(const uint8_t *s, size_t n)
+{
+	uint64_t value = 0;
+	for(size_t i = 0; i < n; ++i)
+	{
+		uint8_t c = s[i];
+		if(__builtin_expect(c < 48 || c > 57, 0))
+		{
+			value = value ^ reject(i, c) ^ reject(i + 1, c) ^ reject(i + 2, c);
+			value = value * 31 + reject(value, c);
+		}
+		else
+			value = value + c;
+	}
+	return value;
+}
+
+int kernel(void)
+{
+	if(input[0] == 0)
+		for(size_t i = 0; i < 4096; ++i) input[i] = 48;
+	return parse(input, 4096) == 1 ? 1 : 0;
+}
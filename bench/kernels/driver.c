@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <time.h>
+
+/* Every kernel, noct or C, defines this. It lives in its own object file so the
+   driver cannot inline or hoist it. */
+int kernel(void);
+
+static double now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	volatile int sink;
+	long         iterations = 1;
+	double       elapsed = 0;
+
+	/* Double the iteration count until a run takes long enough to time. */
+	for(;;)
+	{
+		double begin = now();
+		for(long i = 0; i < iterations; ++i) sink = kernel();
+		elapsed = now() - begin;
+
+		if(elapsed >= 0.2)
+			break;
+		iterations *= 2;
+	}
+
+	(void)sink;
+	printf("%.3f\n", elapsed * 1e9 / iterations);
+	return 0;
+}
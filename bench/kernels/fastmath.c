@@ -0,0 +1,20 @@
+static float xs[4096];
+static float ys[4096];
+
+static float dot(const float *a, const float *b, unsigned long n)
+{
+#pragma clang fp reassociate(on) contract(fast)
+	float s = 0;
+	for(unsigned long i = 0; i < n; ++i) s = s + a[i] * b[i];
+	return s;
+}
+
+int kernel(void)
+{
+	if(xs[1] == 0)
+	{
+		float x = 0;
+		for(unsigned long i = 0; i < 4096; ++i, x += 1) xs[i] = x, ys[i] = 0.5f;
+	}
+	return dot(xs, ys, 4096) > 0 ? 1 : 0;
+}
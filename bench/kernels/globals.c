@@ -0,0 +1,3 @@
+static const int seed = 12345;
+static const int scale = 7;
+int kernel(void) { return seed; }
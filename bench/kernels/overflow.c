@@ -0,0 +1,15 @@
+/* Signed overflow is undefined here as it is for noct's plain `+`, so the loop
+   below cannot run forever and its trip count is known. */
+int last = 4095;
+
+static int mix(int first, int last)
+{
+	int t = 0;
+	for(int i = first; i <= last; ++i) t = t + (i ^ (i >> 3)) * 7;
+	return t;
+}
+
+int kernel(void)
+{
+	return mix(0, last) > 0 ? 1 : 0;
+}
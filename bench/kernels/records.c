@@ -0,0 +1,43 @@
+#include <stddef.h>
+#include <stdint.h>
+
+struct order
+{
+	uint64_t id;
+	uint8_t  flags;
+	double   price;
+	uint8_t  region;
+	uint32_t qty;
+	uint64_t time;
+	uint16_t category;
+	float    score;
+};
+
+static struct order orders[16384];
+static uint32_t     filled = 0;
+
+static uint32_t fill(struct order *s, size_t n)
+{
+	for(uint32_t i = 0; i < n; ++i)
+	{
+		s[i].id = i;
+		s[i].qty = (i * 2654435761u) >> 8;
+		s[i].price = 1.5;
+		s[i].time = i * 7u;
+	}
+	return 1;
+}
+
+static uint64_t total(const struct order *s, size_t n)
+{
+	uint64_t t = 0;
+	for(size_t i = 0; i < n; ++i) t = t + s[i].qty;
+	return t;
+}
+
+int kernel(void)
+{
+	if(filled == 0)
+		filled = fill(orders, 16384);
+	return total(orders, 16384) > 0 ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+/* A call tree too big to inline or unroll away: what calls themselves cost. The
+   depth is a global, so neither compiler can evaluate fib ahead of time. */
+int depth = 20;
+
+static int fib(int n)
+{
+	return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+int kernel(void)
+{
+	return fib(depth) == 6765 ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#include <stddef.h>
+#include <stdint.h>
+
+static uint32_t a[4096];
+static uint32_t b[4096];
+
+/* Exported, so nothing here knows what they point to when the kernel runs. */
+uint32_t *dst;
+uint32_t *src;
+size_t    dst_len;
+size_t    src_len;
+
+static uint32_t scale(uint32_t *restrict d, size_t n, const uint32_t *restrict s, uint32_t k)
+{
+	for(size_t i = 0; i < n; ++i) d[i] = d[i] * k + s[i] + s[0];
+	return d[0];
+}
+
+int kernel(void)
+{
+	if(dst_len == 0)
+	{
+		dst = a, dst_len = 4096;
+		src = b, src_len = 4096;
+	}
+	scale(dst, dst_len, src, 3);
+	uint32_t r = scale(src, src_len, dst, 5);
+	return r == 0 ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+int kernel(void)
+{
+	unsigned acc[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	for(unsigned i = 0; i < 1024; ++i)
+		for(int l = 0; l < 8; ++l) acc[l] = acc[l] * 31 + (acc[l] >> 3) + i;
+
+	unsigned r = 0;
+	for(int l = 0; l < 8; ++l) r ^= acc[l];
+	return r;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# End-to-end build latency of a noct program: linking in-process (noct -o exe)
+# against writing an object and linking it with the clang driver.
+#
+#   bench/link.sh [file.noct] [runs]
+
+NOCT=${NOCT:-./noct}
+CC=${CC:-clang}
+SRC=${1:-example.noct}
+RUNS=${2:-20}
+OUT=bin/bench
+
+mkdir -p $OUT
+
+now() { date +%s%N; }
+
+begin=$(now)
+for i in $(seq $RUNS); do
+	$NOCT $SRC -o $OUT/link-inprocess >/dev/null || exit 1
+done
+inprocess=$(( ($(now) - begin) / RUNS / 1000 ))
+
+begin=$(now)
+for i in $(seq $RUNS); do
+	$NOCT $SRC $OUT/link-driver.o >/dev/null && $CC $OUT/link-driver.o -o $OUT/link-driver \
+	|| exit 1
+done
+driver=$(( ($(now) - begin) / RUNS / 1000 ))
+
+printf "%-24s %10s us\n" "noct -o (in-process)" $inprocess
+printf "%-24s %10s us\n" "noct + $CC" $driver
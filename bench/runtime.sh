@@ -0,0 +1,45 @@
+#!/bin/sh
+# Runtime of noct-generated code against equivalent hand-written C.
+#
+# Every bench/kernels/<name>.noct has a <name>.c twin. Both are compiled at each
+# optimization level and CPU setting, linked against the same driver and timed.
+# CC must be a clang built against the same LLVM as noct. NOCTFLAGS go to every
+# noct invocation, e.g. -fbounds-checks=all to see what elided checks save.
+#
+#   LEVELS="0 2" CPUS="generic native" bench/runtime.sh [kernel...]
+
+set -e
+
+NOCT=${NOCT:-./noct}
+NOCTFLAGS=${NOCTFLAGS:-}
+CC=${CC:-clang}
+LEVELS=${LEVELS:-"0 1 2 3"}
+CPUS=${CPUS:-"generic native"}
+OUT=bin/bench
+
+mkdir -p $OUT
+$CC -O2 -c bench/kernels/driver.c -o $OUT/driver.o
+
+kernels="$*"
+[ -z "$kernels" ] && kernels=$(ls bench/kernels/*.noct | xargs -n1 basename | sed 's/\.noct$//')
+
+printf "%-12s %-4s %-10s %12s %12s %8s\n" kernel opt cpu "noct ns" "c ns" ratio
+
+for name in $kernels; do
+	for level in $LEVELS; do
+		for cpu in $CPUS; do
+			cflags="-O$level"
+			[ "$cpu" != generic ] && cflags="$cflags -march=$cpu"
+
+			$NOCT $NOCTFLAGS -O$level -mcpu=$cpu bench/kernels/$name.noct $OUT/$name.noct.o >/dev/null
+			$CC $cflags -c bench/kernels/$name.c -o $OUT/$name.c.o
+			$CC $OUT/driver.o $OUT/$name.noct.o -o $OUT/$name.noct
+			$CC $OUT/driver.o $OUT/$name.c.o -o $OUT/$name.c
+
+			noct=$($OUT/$name.noct)
+			c=$($OUT/$name.c)
+			printf "%-12s -O%-2s %-10s %12s %12s %8s\n" $name $level $cpu $noct $c \
+			       $(awk "BEGIN { printf \"%.2f\", $noct / $c }")
+		done
+	done
+done
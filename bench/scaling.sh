@@ -0,0 +1,50 @@
+#!/bin/sh
+# How parallel loops scale with the number of threads.
+#
+# Every bench/scaling/<name>.noct does its work in a `parallel for` or `parallel
+# reduce`, and has a <name>.c twin that does the same in a plain loop. The noct
+# kernel is linked against the driver and libnoct-parallel.a, and timed with
+# NOCT_THREADS at 1, 2, 4, ... up to the number of cores. Speedup is against one
+# thread; the C twin shows what the work costs without the runtime.
+#
+#   THREADS="1 2 4 8" bench/scaling.sh [kernel...]
+
+set -e
+
+NOCT=${NOCT:-./noct}
+CC=${CC:-clang}
+CXX=${CXX:-clang++}
+RUNTIME=${RUNTIME:-libnoct-parallel.a}
+OUT=bin/bench
+
+mkdir -p $OUT
+$CC -O2 -c bench/kernels/driver.c -o $OUT/driver.o
+
+if [ -z "$THREADS" ]; then
+	cores=$(nproc)
+	THREADS=1
+	n=2
+	while [ $n -le $cores ]; do THREADS="$THREADS $n"; n=$((n * 2)); done
+	[ $((n / 2)) -ne $cores ] && THREADS="$THREADS $cores"
+fi
+
+kernels="$*"
+[ -z "$kernels" ] && kernels=$(ls bench/scaling/*.noct | xargs -n1 basename | sed 's/\.noct$//')
+
+printf "%-12s %8s %12s %8s\n" kernel threads ns speedup
+
+for name in $kernels; do
+	$NOCT -O2 bench/scaling/$name.noct $OUT/$name.noct.o >/dev/null
+	$CC -O2 -c bench/scaling/$name.c -o $OUT/$name.c.o
+	$CXX $OUT/driver.o $OUT/$name.noct.o $RUNTIME -pthread -o $OUT/$name.parallel
+	$CC $OUT/driver.o $OUT/$name.c.o -o $OUT/$name.c
+
+	printf "%-12s %8s %12s %8s\n" $name C $($OUT/$name.c) -
+	base=
+	for threads in $THREADS; do
+		ns=$(NOCT_THREADS=$threads $OUT/$name.parallel)
+		[ -z "$base" ] && base=$ns
+		printf "%-12s %8s %12s %8s\n" $name $threads $ns \
+		       $(awk "BEGIN { printf \"%.2f\", $base / $ns }")
+	done
+done
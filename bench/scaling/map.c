@@ -0,0 +1,19 @@
+/* The same map as a plain loop, with no runtime to call. */
+#include <stdint.h>
+
+static uint64_t src[1048576];
+static uint64_t dst[1048576];
+
+static uint64_t hash(uint64_t x)
+{
+	uint64_t z = x + 11400714819323198485u;
+	z = (z ^ (z >> 30)) * 13787848793156543929u;
+	z = (z ^ (z >> 27)) * 10723151780598845931u;
+	return z ^ (z >> 31);
+}
+
+int kernel(void)
+{
+	for(uint64_t i = 0; i < 1048576; ++i) dst[i] = hash(src[i] + i);
+	return dst[4095] != 0 ? 1 : 0;
+}
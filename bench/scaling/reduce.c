@@ -0,0 +1,17 @@
+/* The same sum as a plain loop, with no runtime to call. */
+#include <stdint.h>
+
+static uint64_t hash(uint64_t x)
+{
+	uint64_t z = x + 11400714819323198485u;
+	z = (z ^ (z >> 30)) * 13787848793156543929u;
+	z = (z ^ (z >> 27)) * 10723151780598845931u;
+	return z ^ (z >> 31);
+}
+
+int kernel(void)
+{
+	uint64_t total = 0;
+	for(uint64_t i = 0; i < 4194304; ++i) total += hash(i);
+	return total != 0 ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Process startup cost: the same program as a clang-linked, dynamically linked libc
+# binary and as a freestanding static binary from noct -o.
+#
+#   bench/startup.sh [file.noct] [runs]
+
+NOCT=${NOCT:-./noct}
+CC=${CC:-clang}
+SRC=${1:-example.noct}
+RUNS=${2:-1000}
+OUT=bin/bench
+
+mkdir -p $OUT
+
+$NOCT $SRC $OUT/startup-hosted.o >/dev/null \
+&& $CC $OUT/startup-hosted.o -o $OUT/startup-hosted \
+&& $NOCT $SRC -o $OUT/startup-freestanding >/dev/null \
+|| exit 1
+
+now() { date +%s%N; }
+
+measure()
+{
+	begin=$(now)
+	for i in $(seq $RUNS); do $1; done
+	echo $(( ($(now) - begin) / RUNS / 1000 ))
+}
+
+# The shell's fork and exec are in both numbers; an empty run shows how much.
+printf "%-24s %8s us/run\n" "/bin/true" $(measure /bin/true)
+printf "%-24s %8s us/run\n" "hosted ($CC)" $(measure $OUT/startup-hosted)
+printf "%-24s %8s us/run\n" "freestanding (noct -o)" $(measure $OUT/startup-freestanding)
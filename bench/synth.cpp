@@ -0,0 +1,197 @@
+#include "synth.hpp"
+
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+namespace noct::bench
+{
+	namespace
+	{
+		struct Random
+		{
+			std::uint32_t state;
+
+			auto next() -> std::uint32_t
+			{
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				return state;
+			}
+
+			auto below(std::size_t n) -> std::size_t
+			{
+				return n == 0 ? 0 : next() % n;
+			}
+		};
+
+		auto makeIdentifier(Random &rng, char prefix, std::size_t index,
+		                    std::size_t length) -> std::string
+		{
+			static constexpr char letters[] = "abcdefghijklmnopqrstuvwxyz_";
+
+			// The index keeps names unique, the filler makes them long.
+			std::string name = std::string(1, prefix) + std::to_string(index) + "_";
+			while(name.size() < length) name += letters[rng.below(sizeof(letters) - 1)];
+			return name;
+		}
+
+		void generateOperand(std::ostream &out, Random &rng,
+		                     const std::vector<std::string> &globals)
+		{
+			if(!globals.empty() && rng.below(2) == 0)
+				out << globals[rng.below(globals.size())];
+			else
+				out << rng.below(100000);
+		}
+
+		// A flat chain of operators from every precedence level, with the odd
+		// parenthesized pair and prefix operator thrown in.
+		void generateExpression(std::ostream &out, Random &rng, const SynthShape &shape,
+		                        const std::vector<std::string> &globals)
+		{
+			static constexpr const char *operators[] = {
+			    "+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>",
+			    "==", "!=", "<", ">", "<=", ">=", "&&", "||"};
+			static constexpr const char *prefixes[] = {"-", "!", "~"};
+
+			std::size_t open = 0;
+			for(std::size_t i = 0; i <= shape.operators; ++i)
+			{
+				if(i != 0)
+					out << " " << operators[rng.below(std::size(operators))] << " ";
+				if(rng.below(8) == 0)
+					out << prefixes[rng.below(std::size(prefixes))];
+				if(i < shape.operators && rng.below(4) == 0)
+				{
+					out << "(";
+					++open;
+				}
+				generateOperand(out, rng, globals);
+				if(open != 0 && rng.below(3) == 0)
+				{
+					out << ")";
+					--open;
+				}
+			}
+			out << std::string(open, ')');
+		}
+
+		constexpr const char *helperTypes[] = {
+		    "i8", "i16", "i32", "i64", "u8", "u16", "u32", "u64", "f32", "f64"};
+
+		auto isFloatType(std::string_view type) -> bool
+		{
+			return type.front() == 'f';
+		}
+
+		// `fn h0_x<T: numeric>(a: T, b: T) -> T`, or one such function per type with
+		// the type in its name when `shape.monomorphic` is set.
+		void generateHelper(std::ostream &out, const std::string &name, const SynthShape &shape)
+		{
+			auto body = [&](const std::string &signature, const std::string &type) {
+				out << "fn " << signature << "(a: " << type << ", b: " << type << ") -> "
+				    << type << "\n{ let t: " << type
+				    << " = a * b; if t > a { t - a } else { a + b } }\n";
+			};
+
+			if(!shape.monomorphic)
+				body(name + "<T: numeric>", "T");
+			else
+				for(auto type : helperTypes) body(name + "_" + type, type);
+		}
+
+		// A call to a random helper, with arguments of a random type.
+		void generateHelperCall(std::ostream &out, Random &rng, const SynthShape &shape,
+		                        const std::vector<std::string> &helpers)
+		{
+			std::string type = helperTypes[rng.below(std::size(helperTypes))];
+			auto        literal = [&]() {
+				out << rng.below(100) << (isFloatType(type) ? ".5" : "") << type;
+			};
+
+			out << helpers[rng.below(helpers.size())];
+			if(shape.monomorphic)
+				out << "_" << type;
+			out << "(";
+			literal();
+			out << ", ";
+			literal();
+			out << ");";
+		}
+
+		void generateBlock(std::ostream &out, Random &rng, const SynthShape &shape,
+		                   const std::vector<std::string> &globals, std::size_t depth)
+		{
+			out << "{";
+			for(std::size_t i = 0; i < shape.statements; ++i)
+			{
+				out << " ";
+				if(shape.operators == 0)
+					generateOperand(out, rng, globals);
+				else
+				{
+					// Otherwise a leading '-' would continue the previous statement.
+					generateExpression(out, rng, shape, globals);
+					out << ";";
+				}
+			}
+
+			if(depth > 1)
+			{
+				out << "\n" << std::string(shape.depth - depth + 1, '\t');
+				generateBlock(out, rng, shape, globals, depth - 1);
+			}
+			else if(!globals.empty())
+				out << " " << globals[rng.below(globals.size())];
+			else
+				out << " 0";
+
+			out << " }";
+		}
+	} // namespace
+
+	auto generateProgram(const SynthShape &shape) -> std::string
+	{
+		std::stringstream        out;
+		Random                   rng{shape.seed == 0 ? 1 : shape.seed};
+		std::vector<std::string> globals, helpers;
+
+		for(std::size_t i = 0; i < shape.globals; ++i)
+		{
+			globals.push_back(makeIdentifier(rng, 'g', i, shape.identLength));
+			out << "let " << globals.back() << ": i32 = " << rng.below(1000000)
+			    << ";\n";
+		}
+
+		for(std::size_t i = 0; i < shape.generics; ++i)
+		{
+			helpers.push_back(makeIdentifier(rng, 'h', i, shape.identLength));
+			generateHelper(out, helpers.back(), shape);
+		}
+
+		for(std::size_t i = 0; i < shape.functions; ++i)
+		{
+			out << "fn " << makeIdentifier(rng, 'f', i, shape.identLength)
+			    << " -> i32\n";
+
+			// The calls go in a block of their own around the usual body.
+			if(!helpers.empty())
+			{
+				out << "{";
+				for(std::size_t j = 0; j < shape.statements; ++j)
+				{
+					out << " ";
+					generateHelperCall(out, rng, shape, helpers);
+				}
+				out << "\n";
+			}
+			generateBlock(out, rng, shape, globals, shape.depth == 0 ? 1 : shape.depth);
+			out << (helpers.empty() ? "\n" : " }\n");
+		}
+
+		return out.str();
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace noct::bench
+{
+	struct SynthShape
+	{
+		std::size_t   functions   = 1000;
+		std::size_t   globals     = 1000;
+		std::size_t   depth       = 4; // nesting depth of every function body
+		std::size_t   statements  = 4; // nodes per block besides the nested one
+		std::size_t   operators   = 0; // binary operators per statement
+		std::size_t   identLength = 8;
+		std::size_t   generics    = 0; // generic helpers, called at the top of every function
+		bool          monomorphic = false; // a copy of each helper per type, by hand
+		std::uint32_t seed        = 1;
+	};
+
+	// Deterministic for a given shape, so numbers stay comparable across runs.
+	auto generateProgram(const SynthShape &shape) -> std::string;
+}
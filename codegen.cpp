@@ -1,25 +1,41 @@
 #include "codegen.hpp"
+#include "analysis.hpp"
 #include "ast.hpp"
+#include "linker.hpp"
 #include "util.hpp"
 #include "fmt.hpp"
 #include "log.hpp"
 
+#include <algorithm>
 #include <utility>
 #include <stack>
+#include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <initializer_list>
+#include <optional>
 
+#include <llvm/Analysis/ModuleSummaryAnalysis.h>
+#include <llvm/Analysis/ProfileSummaryInfo.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/InlineAsm.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/Type.h>
+#include <llvm/IR/ValueHandle.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Passes/PassBuilder.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/PGOOptions.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/TargetRegistry.h>
@@ -27,6 +43,7 @@
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/IPO/HotColdSplitting.h>
 
 namespace
 {
@@ -55,18 +72,27 @@ namespace noct
 		Ptr<Type>   type;
 		llvm::Type *llvmType;
 		std::string name;
+
+		virtual ~Variable() = default;
 	};
 
 	struct Global : Variable
 	{
 		llvm::GlobalVariable *llvmVar;
 
-		Global(llvm::GlobalVariable *v) : llvmVar(v) {}
+		Global(llvm::GlobalVariable *v) : llvmVar(v)
+		{
+			llvmType = v->getValueType();
+		}
 	};
 
+	// Locals never touch memory: their values live in GeneratorImpl::currentDef.
 	struct Local : Variable
 	{
-		llvm::Value *llvmVar;
+		Local(llvm::Type *t)
+		{
+			llvmType = t;
+		}
 	};
 
 	class Env
@@ -88,10 +114,10 @@ namespace noct
 		void set(const std::string &name, Args &&...args)
 		{
 			if(auto i = it_(name); i.error)
-				i.value->second = std::make_unique<T>(std::forward<Args...>(args...));
+				values[name] = std::make_unique<T>(std::forward<Args>(args)...);
 		}
 
-		bool isLoop, isFunc;
+		bool isLoop = false, isFunc = false;
 
 	private:
 		using MapType = std::unordered_map<std::string, std::unique_ptr<Variable>>;
@@ -106,29 +132,79 @@ namespace noct
 
 	struct GeneratorImpl
 	{
-		std::string                   moduleName;
-		llvm::LLVMContext             context;
-		llvm::IRBuilder<>             builder;
-		std::unique_ptr<llvm::Module> codeModule;
+		std::string                        moduleName;
+		std::unique_ptr<llvm::LLVMContext> ownedContext;
+		llvm::LLVMContext                 &context;
+		llvm::IRBuilder<>                  builder;
+		std::unique_ptr<llvm::Module>      codeModule;
 
 		std::vector<Env> baseEnv;
 
-		bool        shouldOutputAssembly;
+		bool        shouldOutputAssembly = false;
 		std::string outputAssemblyFile;
 
-		bool        shouldOutputObject;
+		bool        shouldOutputObject = false;
 		std::string outputObjectFile;
 
-		bool        shouldOutputIR;
+		bool        shouldOutputIR = false;
 		std::string outputIRFile;
 
+		bool        shouldOutputBitcode = false;
+		std::string outputBitcodeFile;
+
+		bool        shouldOutputExecutable = false;
+		std::string outputExecutableFile;
+
+		int         optimizationLevel = 0;
+		std::string targetCPU = "generic";
+		bool        freestanding = false;
+
+		bool instrumentFunctions = false;
+		bool boundsChecks = true;
+
+		// The alias scope of each restrict parameter of the function being generated.
+		std::vector<std::pair<std::string, llvm::MDNode *>> aliasScopes;
+
+		// Calls inside a @cold block are cold call sites. Once the module has any
+		// cold code, the optimizer splits it out of the functions it sits in.
+		bool cold = false;
+		bool hasColdCode = false;
+
+		bool        shouldGenerateProfile = false;
+		std::string profileGenerateFile = "default_%m.profraw";
+
+		bool        shouldUseProfile = false;
+		std::string profileUseFile;
+
 		GeneratorImpl(const std::string &moduleName);
+		GeneratorImpl(const std::string &moduleName, llvm::LLVMContext &context);
 		void generateFunction(ASTFunc *func);
 		void generateGlobal(ASTVar *var);
 
-		void output();
+		bool optimize(llvm::TargetMachine *machine);
+		bool output();
 
 		void provideImpls(AST *ast);
+
+		auto lookup(const std::string &name) -> Variable *;
+
+		// On-the-fly SSA construction for locals, after Braun et al., "Simple and
+		// Efficient Construction of Static Single Assignment Form". A block is
+		// sealed once all of its predecessors are known; reads in unsealed blocks
+		// get operandless phis that are completed when it is.
+		std::unordered_map<llvm::BasicBlock *, std::unordered_map<Local *, llvm::Value *>>
+		    currentDef;
+		std::unordered_map<llvm::BasicBlock *,
+		                   std::vector<std::pair<Local *, llvm::PHINode *>>>
+		                                      incompletePhis;
+		std::unordered_set<llvm::BasicBlock *> sealedBlocks;
+
+		void writeVariable(Local *var, llvm::BasicBlock *block, llvm::Value *value);
+		auto readVariable(Local *var, llvm::BasicBlock *block) -> llvm::Value *;
+		auto readVariableRecursive(Local *var, llvm::BasicBlock *block) -> llvm::Value *;
+		auto addPhiOperands(Local *var, llvm::PHINode *phi) -> llvm::Value *;
+		auto tryRemoveTrivialPhi(llvm::PHINode *phi) -> llvm::Value *;
+		void sealBlock(llvm::BasicBlock *block);
 	};
 
 	struct ASTImpl
@@ -160,32 +236,593 @@ namespace noct
 		case NumericType::f32:
 			return llvm::Type::getFloatTy(ctx);
 		case NumericType::f64:
-			return llvm::Type::getFloatTy(ctx);
+			return llvm::Type::getDoubleTy(ctx);
 		default:
 			return nullptr;
 		}
 	}
 
+	llvm::Type *convertTypeToLLVMType(GeneratorImpl &env, const Ptr<Type> &p);
+
+	// The fields in memory order. Every field is naturally aligned unless it is
+	// packed, which LLVM lays out the same way; @align(N) pads the end.
+	llvm::StructType *convertStructToLLVMType(GeneratorImpl &env, const TypeStruct &s)
+	{
+		auto name = "struct." + s.name;
+		if(auto *t = llvm::StructType::getTypeByName(env.context, name); t != nullptr)
+			return t;
+
+		std::vector<llvm::Type *> fields(s.fields.size());
+		std::uint64_t             end = 0;
+		for(const auto &f : s.fields)
+		{
+			fields[f.position] = convertTypeToLLVMType(env, f.type);
+			end = std::max(end, f.offset + f.type->size());
+		}
+
+		std::uint64_t natural = 1;
+		for(const auto &f : s.fields)
+			natural = s.packed ? 1 : std::max(natural, getTypeAlignment(f.type));
+		if(auto size = (end + natural - 1) / natural * natural; size < s.bytes)
+			fields.push_back(llvm::ArrayType::get(llvm::Type::getInt8Ty(env.context),
+			                                      s.bytes - size));
+		return llvm::StructType::create(env.context, fields, name, s.packed);
+	}
+
+	// Where the elements of a slice are: an @soa one points to the bytes of its
+	// arrays.
+	llvm::Type *convertSliceDataToLLVMType(GeneratorImpl &env, const TypeSlice &s)
+	{
+		if(s.soa)
+			return llvm::Type::getInt8PtrTy(env.context);
+		return convertTypeToLLVMType(env, s.element)->getPointerTo();
+	}
+
 	llvm::Type *convertTypeToLLVMType(GeneratorImpl &env, const Ptr<Type> &p)
 	{
 		if(auto t = dynamic_cast<TypeNumeric *>(p.get()); t != nullptr)
 			return convertNumericTypeToLLVMType(env.context, t->numeric);
+		if(auto t = dynamic_cast<TypeVector *>(p.get()); t != nullptr)
+			return llvm::FixedVectorType::get(
+			    convertNumericTypeToLLVMType(env.context, t->element), t->lanes);
+		if(auto t = dynamic_cast<TypeStruct *>(p.get()); t != nullptr)
+			return convertStructToLLVMType(env, *t);
+		if(auto t = dynamic_cast<TypeArray *>(p.get()); t != nullptr && t->soa)
+		{
+			// An array per field, back to back in the order of TypeStruct::layOut.
+			auto                     *s = getStructElement(p);
+			std::vector<llvm::Type *> arrays(s->fields.size());
+			std::vector<std::size_t>  order(s->fields.size());
+			for(std::size_t i = 0; i < s->fields.size(); ++i) order[i] = i;
+			std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+				return s->fields[a].soaOffset < s->fields[b].soaOffset;
+			});
+			for(std::size_t i = 0; i < order.size(); ++i)
+				arrays[i] = llvm::ArrayType::get(
+				    convertTypeToLLVMType(env, s->fields[order[i]].type), t->count);
+			return llvm::StructType::get(env.context, arrays, true);
+		}
+		if(auto t = dynamic_cast<TypeArray *>(p.get()); t != nullptr)
+			return llvm::ArrayType::get(convertTypeToLLVMType(env, t->element), t->count);
+		if(auto t = dynamic_cast<TypeSlice *>(p.get()); t != nullptr)
+			return llvm::StructType::get(env.context, {convertSliceDataToLLVMType(env, *t),
+			                                           llvm::Type::getInt64Ty(env.context)});
+		if(auto t = dynamic_cast<TypePointer *>(p.get()); t != nullptr)
+			return convertTypeToLLVMType(env, t->base)->getPointerTo();
+		if(dynamic_cast<TypeUnit *>(p.get()) != nullptr)
+			return llvm::Type::getVoidTy(env.context);
 
 		return nullptr;
 	}
 
+	// A slice goes in as its pointer and its length, so that the pointer can carry
+	// parameter attributes. To C it is `(T *p, size_t n)`.
+	llvm::FunctionType *convertSignatureToLLVMType(GeneratorImpl &env,
+	                                               const FuncSignature &signature)
+	{
+		std::vector<llvm::Type *> args;
+		for(const auto &t : signature.argTypes)
+			if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+			{
+				args.push_back(convertSliceDataToLLVMType(env, *s));
+				args.push_back(llvm::Type::getInt64Ty(env.context));
+			}
+			else
+				args.push_back(convertTypeToLLVMType(env, t));
+
+		return llvm::FunctionType::get(convertTypeToLLVMType(env, signature.returnType),
+		                               args, false);
+	}
+
 	llvm::Function *generateFunctionProto(GeneratorImpl &env, FuncDeclaration &decl)
 	{
-		llvm::FunctionType *ft = llvm::FunctionType::get(
-		                             convertTypeToLLVMType(env, decl.signature.returnType),
-		                             std::vector<llvm::Type *>(), false);
+		llvm::FunctionType *ft = convertSignatureToLLVMType(env, decl.signature);
+
+		// A call earlier in the module may already have declared it.
+		llvm::Function *f = env.codeModule->getFunction(decl.name);
+		if(f == nullptr)
+			f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage, decl.name,
+			                           env.codeModule.get());
+
+		for(std::size_t i = 0, a = 0; i < decl.argNames.size(); ++i, ++a)
+		{
+			f->getArg(a)->setName(decl.argNames[i]);
+			if(dynamic_cast<TypeSlice *>(decl.signature.argTypes[i].get()) != nullptr)
+				f->getArg(++a)->setName(decl.argNames[i] + ".len");
+		}
+
+		// Nothing outside the module can call it, so the convention is ours to pick.
+		if(!decl.exported)
+		{
+			f->setLinkage(llvm::Function::InternalLinkage);
+			f->setCallingConv(llvm::CallingConv::Fast);
+			for(auto *user : f->users())
+				if(auto *call = llvm::dyn_cast<llvm::CallBase>(user))
+					call->setCallingConv(llvm::CallingConv::Fast);
+		}
+
+		return f;
+	}
+
+	// The numeric type of a scalar, or of each lane of a vector.
+	NumericType getElementNumericType(const Ptr<Type> &t)
+	{
+		if(auto n = dynamic_cast<TypeNumeric *>(t.get()); n != nullptr)
+			return n->numeric;
+		if(auto v = dynamic_cast<TypeVector *>(t.get()); v != nullptr)
+			return v->element;
+		return NumericType::unknown;
+	}
+
+	// Conversion between two numeric types, by the sign of the source going from an
+	// integer and of the target going to one. A scalar going into a vector is
+	// broadcast to every lane.
+	llvm::Value *convertValue(GeneratorImpl &env, llvm::Value *v, const Ptr<Type> &from,
+	                          const Ptr<Type> &to)
+	{
+		auto *t = convertTypeToLLVMType(env, to);
+		if(v == nullptr || t == nullptr || v->getType() == t)
+			return v;
+
+		// An array goes around by address; as a slice, that and its length.
+		auto array = dynamic_cast<TypeArray *>(from.get());
+		if(array != nullptr && dynamic_cast<TypeSlice *>(to.get()) != nullptr)
+		{
+			auto *data = array->soa ? env.builder.CreatePointerCast(v, env.builder.getInt8PtrTy())
+			                        : env.builder.CreateConstInBoundsGEP2_64(
+			                              convertTypeToLLVMType(env, from), v, 0, 0);
+			auto *slice = env.builder.CreateInsertValue(llvm::UndefValue::get(t), data, 0);
+			return env.builder.CreateInsertValue(slice, env.builder.getInt64(array->count), 1);
+		}
+
+		auto *s = v->getType();
+		if(auto *vector = llvm::dyn_cast<llvm::FixedVectorType>(t); vector && !s->isVectorTy())
+			return env.builder.CreateVectorSplat(
+			    vector->getNumElements(),
+			    convertValue(env, v, from, makePtr<TypeNumeric>(getElementNumericType(to))));
+
+		bool fromSigned = isSignedNumericType(getElementNumericType(from));
+		bool toSigned = isSignedNumericType(getElementNumericType(to));
+		if(s->isIntOrIntVectorTy() && t->isIntOrIntVectorTy())
+			return env.builder.CreateIntCast(v, t, fromSigned);
+		if(s->isIntOrIntVectorTy() && t->isFPOrFPVectorTy())
+			return fromSigned ? env.builder.CreateSIToFP(v, t) : env.builder.CreateUIToFP(v, t);
+		if(s->isFPOrFPVectorTy() && t->isIntOrIntVectorTy())
+			return toSigned ? env.builder.CreateFPToSI(v, t) : env.builder.CreateFPToUI(v, t);
+		if(s->isFPOrFPVectorTy() && t->isFPOrFPVectorTy())
+			return env.builder.CreateFPCast(v, t);
+		return v;
+	}
+
+	// Lane counts are powers of two, so wrapping an index around is a mask.
+	llvm::Value *wrapLaneIndex(GeneratorImpl &env, llvm::Value *vector, llvm::Value *index)
+	{
+		auto lanes = llvm::cast<llvm::FixedVectorType>(vector->getType())->getNumElements();
+		return env.builder.CreateAnd(index, lanes - 1);
+	}
+
+	// Traps unless `ok` holds. Checks all but never fail, so the branch says so.
+	void generateTrapUnless(GeneratorImpl &env, llvm::Value *ok, const char *passName,
+	                        const char *failName)
+	{
+		auto *f = env.builder.GetInsertBlock()->getParent();
+		auto *failBlock = llvm::BasicBlock::Create(env.context, failName, f);
+		auto *okBlock = llvm::BasicBlock::Create(env.context, passName, f);
+		env.builder.CreateCondBr(ok, okBlock, failBlock,
+		                         llvm::MDBuilder(env.context).createBranchWeights(1 << 20, 1));
+		env.sealBlock(failBlock);
+		env.sealBlock(okBlock);
+
+		env.builder.SetInsertPoint(failBlock);
+		env.builder.CreateIntrinsic(llvm::Intrinsic::trap, {}, {});
+		env.builder.CreateUnreachable();
+		env.builder.SetInsertPoint(okBlock);
+	}
+
+	// Traps unless index < length.
+	void generateBoundsCheck(GeneratorImpl &env, llvm::Value *index, llvm::Value *length)
+	{
+		generateTrapUnless(env, env.builder.CreateICmpULT(index, length), "inbounds",
+		                   "outofbounds");
+	}
+
+	// Which way a branch on `cond` is expected to go, if the program says so:
+	// likely() or unlikely() around the condition, or a @cold block as one arm.
+	auto getExpectedBranch(AST *cond, AST *then, AST *otherwise) -> std::optional<bool>
+	{
+		if(auto c = dynamic_cast<ASTCall *>(cond); c != nullptr)
+			if(c->builtin == Builtin::likely || c->builtin == Builtin::unlikely)
+				return c->builtin == Builtin::likely;
+
+		auto isCold = [](AST *n) {
+			auto b = dynamic_cast<ASTBlock *>(n);
+			return b != nullptr && b->isCold();
+		};
+		if(isCold(then) != isCold(otherwise))
+			return !isCold(then);
+		return std::nullopt;
+	}
+
+	// The weights llvm.expect lowers to, or none without an expectation.
+	auto createExpectedBranchWeights(GeneratorImpl &env, std::optional<bool> taken)
+	    -> llvm::MDNode *
+	{
+		constexpr std::uint32_t likely = 2000, unlikely = 1;
+		if(!taken)
+			return nullptr;
+		return llvm::MDBuilder(env.context)
+		    .createBranchWeights(*taken ? likely : unlikely, *taken ? unlikely : likely);
+	}
+
+	// `+?`, `-?` and `*?`: the operation through its *.with.overflow intrinsic,
+	// trapping when any lane overflowed.
+	llvm::Value *generateCheckedArithmetic(GeneratorImpl &env, llvm::Intrinsic::ID id,
+	                                       llvm::Value *l, llvm::Value *r)
+	{
+		auto *result = env.builder.CreateBinaryIntrinsic(id, l, r);
+		llvm::Value *overflow = env.builder.CreateExtractValue(result, 1);
+		if(overflow->getType()->isVectorTy())
+			overflow = env.builder.CreateOrReduce(overflow);
+		generateTrapUnless(env, env.builder.CreateNot(overflow), "nooverflow", "overflow");
+		return env.builder.CreateExtractValue(result, 0);
+	}
 
-		llvm::Function *f = llvm::Function::Create(ft, llvm::Function::ExternalLinkage,
-		                                           decl.name, env.codeModule.get());
+	// The number of elements of an array, which is itself an address, or of a slice.
+	llvm::Value *generateLength(GeneratorImpl &env, llvm::Value *base, const Ptr<Type> &baseType)
+	{
+		if(auto array = dynamic_cast<TypeArray *>(baseType.get()); array != nullptr)
+			return env.builder.getInt64(array->count);
+		return env.builder.CreateExtractValue(base, 1);
+	}
 
+	// An index into an array or a slice as an i64, checked against its length. A
+	// negative index sign-extends to one that fails the check.
+	llvm::Value *generateIndex(GeneratorImpl &env, llvm::Value *base, const Ptr<Type> &baseType,
+	                           llvm::Value *index, const Ptr<Type> &indexType, bool checked)
+	{
+		index = env.builder.CreateIntCast(index, env.builder.getInt64Ty(),
+		                                  isSignedNumericType(getElementNumericType(indexType)));
+		if(checked && env.boundsChecks)
+			generateBoundsCheck(env, index, generateLength(env, base, baseType));
+		return index;
+	}
+
+	// The address of an element of an array or of a slice.
+	llvm::Value *generateElementPointer(GeneratorImpl &env, llvm::Value *base,
+	                                    const Ptr<Type> &baseType, llvm::Value *index,
+	                                    const Ptr<Type> &indexType, bool checked)
+	{
+		index = generateIndex(env, base, baseType, index, indexType, checked);
+		if(dynamic_cast<TypeArray *>(baseType.get()) != nullptr)
+			return env.builder.CreateInBoundsGEP(convertTypeToLLVMType(env, baseType), base,
+			                                     {env.builder.getInt64(0), index});
+
+		auto *slice = static_cast<TypeSlice *>(baseType.get());
+		return env.builder.CreateInBoundsGEP(convertTypeToLLVMType(env, slice->element),
+		                                     env.builder.CreateExtractValue(base, 0), index);
+	}
+
+	// The address of a field of a struct variable, which is itself an address, or
+	// of an element of an array or slice of structs, and how aligned it is there.
+	// `index` is null for a variable. Of an @soa array of n, field f is element i
+	// of the array that starts at byte n * f.soaOffset.
+	auto generateFieldPointer(GeneratorImpl &env, llvm::Value *base, const Ptr<Type> &baseType,
+	                          llvm::Value *index, const Ptr<Type> &indexType, bool checked,
+	                          std::size_t field) -> std::pair<llvm::Value *, llvm::Align>
+	{
+		auto *s = index == nullptr ? static_cast<TypeStruct *>(baseType.get())
+		                           : getStructElement(baseType);
+		const auto &f = s->fields[field];
+
+		auto array = dynamic_cast<TypeArray *>(baseType.get());
+		auto slice = dynamic_cast<TypeSlice *>(baseType.get());
+		if((array != nullptr && array->soa) || (slice != nullptr && slice->soa))
+		{
+			index = generateIndex(env, base, baseType, index, indexType, checked);
+			auto *data = array != nullptr
+			                 ? env.builder.CreatePointerCast(base, env.builder.getInt8PtrTy())
+			                 : env.builder.CreateExtractValue(base, 0);
+			auto *start = env.builder.CreateInBoundsGEP(
+			    env.builder.getInt8Ty(), data,
+			    env.builder.CreateMul(generateLength(env, base, baseType),
+			                          env.builder.getInt64(f.soaOffset), "", true, true));
+
+			auto *type = convertTypeToLLVMType(env, f.type);
+			return {env.builder.CreateInBoundsGEP(
+			            type, env.builder.CreatePointerCast(start, type->getPointerTo()), index),
+			        llvm::Align(getTypeAlignment(f.type))};
+		}
+
+		if(index != nullptr)
+			base = generateElementPointer(env, base, baseType, index, indexType, checked);
+		return {env.builder.CreateStructGEP(convertStructToLLVMType(env, *s), base, f.position),
+		        llvm::commonAlignment(llvm::Align(s->alignment), f.offset)};
+	}
+
+	// Structs and arrays live in memory, and go around by address.
+	auto isInPlace(const Ptr<Type> &t) -> bool
+	{
+		return dynamic_cast<TypeArray *>(t.get()) != nullptr
+		    || dynamic_cast<TypeStruct *>(t.get()) != nullptr;
+	}
+
+	// What alignment a struct, or an array of them, asks for beyond that of its LLVM
+	// type: @align(N), or a packed struct inside. Nothing for anything else.
+	auto getStructAlignment(const Ptr<Type> &t) -> std::optional<llvm::Align>
+	{
+		if(dynamic_cast<TypeStruct *>(t.get()) == nullptr && getStructElement(t) == nullptr)
+			return std::nullopt;
+		return llvm::Align(getTypeAlignment(t));
+	}
+
+	// What the typechecker verified of @pure and @const, for a function or a call to
+	// one. Instrumented functions call into the profiling runtime, which writes.
+	auto getPurityAttributes(GeneratorImpl &env, Purity purity)
+	    -> std::vector<llvm::Attribute::AttrKind>
+	{
+		// Nothing in noct unwinds, and every callee is noct code.
+		if(purity == Purity::impure || env.instrumentFunctions)
+			return {llvm::Attribute::NoUnwind};
+
+		return {llvm::Attribute::NoUnwind, llvm::Attribute::WillReturn,
+		        purity == Purity::constant ? llvm::Attribute::ReadNone
+		                                   : llvm::Attribute::ReadOnly};
+	}
+
+	void generateFunctionAttributes(GeneratorImpl &env, llvm::Function *f,
+	                                const FuncDeclaration &decl)
+	{
+		constexpr std::pair<const char *, llvm::Attribute::AttrKind> attributes[] = {
+			{ "inline", llvm::Attribute::InlineHint },
+			{ "noinline", llvm::Attribute::NoInline },
+			{ "always_inline", llvm::Attribute::AlwaysInline },
+			{ "hot", llvm::Attribute::Hot },
+			{ "cold", llvm::Attribute::Cold },
+		};
+
+		for(auto kind : getPurityAttributes(env, decl.purity())) f->addFnAttr(kind);
+		env.hasColdCode = env.hasColdCode || decl.hasAttribute("cold");
+		for(const auto &[name, kind] : attributes)
+			if(decl.hasAttribute(name))
+				f->addFnAttr(kind);
+	}
+
+	llvm::FastMathFlags convertFastMathFlags(std::uint8_t flags)
+	{
+		llvm::FastMathFlags f;
+		f.setAllowReassoc(flags & FastMath::reassoc);
+		f.setAllowContract(flags & FastMath::contract);
+		f.setNoNaNs(flags & FastMath::nnan);
+		f.setNoInfs(flags & FastMath::ninf);
+		f.setNoSignedZeros(flags & FastMath::nsz);
+		f.setAllowReciprocal(flags & FastMath::arcp);
+		f.setApproxFunc(flags & FastMath::afn);
 		return f;
 	}
 
+	// LLVM has no @flatten of its own; like clang, inline every call in the function.
+	void flattenCalls(llvm::Function *f)
+	{
+		for(auto &bb : *f)
+			for(auto &inst : bb)
+				if(auto *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+					if(auto *callee = call->getCalledFunction();
+					   callee != nullptr && !callee->isIntrinsic())
+						call->addFnAttr(llvm::Attribute::AlwaysInline);
+	}
+
+	// Parameter attributes for the pointer and slice parameters of `func`, and an
+	// alias scope for each of its restrict ones that keeps its name throughout.
+	void generatePointerParams(GeneratorImpl &env, llvm::Function *f, const ASTFunc *func)
+	{
+		llvm::MDBuilder md(env.context);
+		llvm::MDNode   *domain = nullptr;
+
+		const auto &decl = func->decl;
+		for(std::size_t i = 0, a = 0; i < decl.argNames.size(); ++i, ++a)
+		{
+			const auto &type = decl.signature.argTypes[i];
+			auto       *q = getPointerQualifiers(type);
+			if(q == nullptr)
+				continue;
+
+			auto usage = getParamUsage(func->body.get(), decl.argNames[i]);
+			if(q->restrict)
+				f->addParamAttr(a, llvm::Attribute::NoAlias);
+			if(q->readonly)
+				f->addParamAttr(a, llvm::Attribute::ReadOnly);
+			if(!usage.captured)
+				f->addParamAttr(a, llvm::Attribute::NoCapture);
+
+			if(q->restrict && !usage.rebound)
+			{
+				if(domain == nullptr)
+					domain = md.createAnonymousAliasScopeDomain(decl.name);
+				env.aliasScopes.emplace_back(
+				    decl.argNames[i], md.createAnonymousAliasScope(domain, decl.argNames[i]));
+			}
+
+			if(dynamic_cast<TypeSlice *>(type.get()) != nullptr)
+				++a;
+		}
+	}
+
+	// An access through a restrict parameter is in its scope; every access is
+	// outside the scopes of the others. `name` is the variable accessed through.
+	void annotateAccess(GeneratorImpl &env, llvm::Instruction *access, const std::string &name)
+	{
+		std::vector<llvm::Metadata *> others;
+		for(const auto &[param, scope] : env.aliasScopes)
+			if(param == name)
+				access->setMetadata(llvm::LLVMContext::MD_alias_scope,
+				                    llvm::MDNode::get(env.context, {scope}));
+			else
+				others.push_back(scope);
+
+		if(!others.empty())
+			access->setMetadata(llvm::LLVMContext::MD_noalias,
+			                    llvm::MDNode::get(env.context, others));
+	}
+
+	// A loop rather than llvm.memset, which can become a call to memset, and a
+	// freestanding executable has none.
+	void generateZeroFill(GeneratorImpl &env, llvm::Value *array, llvm::ArrayType *type)
+	{
+		auto *f = env.builder.GetInsertBlock()->getParent();
+		auto *before = env.builder.GetInsertBlock();
+		auto *loopBlock = llvm::BasicBlock::Create(env.context, "zero", f);
+		auto *doneBlock = llvm::BasicBlock::Create(env.context, "zeroed", f);
+		env.builder.CreateBr(loopBlock);
+
+		env.builder.SetInsertPoint(loopBlock);
+		auto *i = env.builder.CreatePHI(env.builder.getInt64Ty(), 2);
+		env.builder.CreateStore(
+		    llvm::Constant::getNullValue(type->getElementType()),
+		    env.builder.CreateInBoundsGEP(type, array, {env.builder.getInt64(0), i}));
+		auto *next = env.builder.CreateAdd(i, env.builder.getInt64(1), "", true, true);
+		env.builder.CreateCondBr(
+		    env.builder.CreateICmpULT(next, env.builder.getInt64(type->getNumElements())),
+		    loopBlock, doneBlock);
+		i->addIncoming(env.builder.getInt64(0), before);
+		i->addIncoming(next, loopBlock);
+		env.sealBlock(loopBlock);
+		env.sealBlock(doneBlock);
+
+		env.builder.SetInsertPoint(doneBlock);
+	}
+
+	// A local array or struct starts out zero. Each array of an @soa array is
+	// zeroed on its own.
+	void generateZeroInit(GeneratorImpl &env, llvm::Value *slot, llvm::Type *type)
+	{
+		if(auto *array = llvm::dyn_cast<llvm::ArrayType>(type); array != nullptr)
+			return generateZeroFill(env, slot, array);
+
+		auto *s = llvm::cast<llvm::StructType>(type);
+		if(!s->isLiteral())
+		{
+			env.builder.CreateStore(llvm::Constant::getNullValue(s), slot);
+			return;
+		}
+		for(unsigned i = 0; i < s->getNumElements(); ++i)
+			generateZeroFill(env, env.builder.CreateStructGEP(s, slot, i),
+			                 llvm::cast<llvm::ArrayType>(s->getElementType(i)));
+	}
+
+	// Brackets the function with calls into runtime/profile.cpp. Each function gets
+	// a { name, slot } site record that the runtime fills in on first entry.
+	void instrumentFunction(GeneratorImpl &env, llvm::Function *f)
+	{
+		auto &ctx = env.context;
+		auto *siteType = llvm::StructType::get(ctx, {llvm::Type::getInt8PtrTy(ctx),
+		                                             llvm::Type::getInt64Ty(ctx)});
+		auto *hookType = llvm::FunctionType::get(llvm::Type::getVoidTy(ctx),
+		                                         {siteType->getPointerTo()}, false);
+
+		auto enter = env.codeModule->getOrInsertFunction("__noct_prof_enter", hookType);
+		auto exit = env.codeModule->getOrInsertFunction("__noct_prof_exit", hookType);
+
+		auto &entry = f->getEntryBlock();
+		env.builder.SetInsertPoint(&entry, entry.getFirstInsertionPt());
+
+		auto *name = env.builder.CreateGlobalStringPtr(f->getName(), "",
+		                                               0, env.codeModule.get());
+		auto *site = new llvm::GlobalVariable(
+		    *env.codeModule, siteType, false, llvm::GlobalVariable::PrivateLinkage,
+		    llvm::ConstantStruct::get(siteType,
+		                              {name, llvm::ConstantInt::get(
+		                                         llvm::Type::getInt64Ty(ctx), 0)}),
+		    "__noct_prof_site." + f->getName());
+
+		env.builder.CreateCall(enter, {site});
+
+		for(auto &bb : *f)
+			if(auto *ret = llvm::dyn_cast<llvm::ReturnInst>(bb.getTerminator()))
+			{
+				env.builder.SetInsertPoint(ret);
+				env.builder.CreateCall(exit, {site});
+			}
+	}
+
+	// The freestanding entry point: call main and hand its result straight to the
+	// exit_group syscall. The kernel enters _start with an aligned stack and no return
+	// address, which stackrealign accounts for.
+	bool generateStartup(GeneratorImpl &env, const llvm::Triple &triple)
+	{
+		auto &ctx = env.context;
+		auto *i64 = llvm::Type::getInt64Ty(ctx);
+
+		llvm::InlineAsm *exit = nullptr;
+		std::uint64_t    exitGroup = 0;
+		if(triple.getArch() == llvm::Triple::x86_64)
+		{
+			exitGroup = 231;
+			exit = llvm::InlineAsm::get(
+			    llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {i64, i64}, false),
+			    "syscall", "{rax},{rdi},~{rcx},~{r11},~{memory}", true);
+		}
+		else if(triple.getArch() == llvm::Triple::aarch64)
+		{
+			exitGroup = 94;
+			exit = llvm::InlineAsm::get(
+			    llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), {i64, i64}, false),
+			    "svc #0", "{x8},{x0},~{memory}", true);
+		}
+		else
+		{
+			error("The freestanding target does not support '{0}'.", triple.str());
+			return false;
+		}
+
+		auto *main = env.codeModule->getFunction("main");
+		if(main == nullptr)
+		{
+			error("No 'main' function for the freestanding entry point.");
+			return false;
+		}
+		// Its result is the exit status.
+		if(!main->getReturnType()->isIntegerTy() || main->arg_size() != 0)
+		{
+			error("The freestanding entry point needs 'main' to take nothing and return an "
+			      "integer.");
+			return false;
+		}
+
+		auto *start = llvm::Function::Create(
+		    llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), false),
+		    llvm::Function::ExternalLinkage, "_start", env.codeModule.get());
+		start->addFnAttr(llvm::Attribute::NoReturn);
+		start->addFnAttr(llvm::Attribute::NoUnwind);
+		start->addFnAttr("stackrealign");
+
+		env.builder.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", start));
+		auto *status = env.builder.CreateCall(main);
+		env.builder.CreateCall(exit, {llvm::ConstantInt::get(i64, exitGroup),
+		                              env.builder.CreateSExtOrTrunc(status, i64)});
+		env.builder.CreateUnreachable();
+		return true;
+	}
+
 	struct ASTVarImpl : ASTImpl
 	{
 		ASTVar *node;
@@ -193,23 +830,71 @@ namespace noct
 
 		llvm::Value *gen(GeneratorImpl &env) const noexcept override
 		{
+			auto *type = convertTypeToLLVMType(env, node->decl.type);
+
+			if(node->decl.local && isInPlace(node->decl.type))
+			{
+				// Allocated once in the entry block, so that a loop does not grow the
+				// stack, and zeroed wherever it is declared.
+				auto &entry = env.builder.GetInsertBlock()->getParent()->getEntryBlock();
+				llvm::IRBuilder<> top(&entry, entry.begin());
+				auto *slot = top.CreateAlloca(type, nullptr, node->decl.name);
+				if(auto align = getStructAlignment(node->decl.type))
+					slot->setAlignment(std::max(slot->getAlign(), *align));
+				generateZeroInit(env, slot, type);
+
+				env.baseEnv.back().set<Local>(node->decl.name, slot->getType());
+				env.writeVariable(static_cast<Local *>(env.baseEnv.back().get(node->decl.name)),
+				                  env.builder.GetInsertBlock(), slot);
+				return slot;
+			}
+
+			if(node->decl.local)
+			{
+				auto *value = node->value == nullptr
+				                  ? llvm::Constant::getNullValue(type)
+				                  : convertValue(env, node->value->impl_->gen(env),
+				                                 node->value->checkedType, node->decl.type);
+
+				env.baseEnv.back().set<Local>(node->decl.name, type);
+				env.writeVariable(static_cast<Local *>(env.baseEnv.back().get(node->decl.name)),
+				                  env.builder.GetInsertBlock(), value);
+				return value;
+			}
+
+			// The constant evaluator has already folded every initializer it could.
 			llvm::Constant *initializer = nullptr;
 			if(node->value)
 			{
-				auto *v = node->value->impl_->gen(env);
-				if(!llvm::isa<llvm::Constant>(v))
-					initializer = llvm::cast<llvm::Constant>(v);
-				else
+				auto n = dynamic_cast<ASTInt *>(node->value.get());
+				auto f = dynamic_cast<ASTFloat *>(node->value.get());
+				if(n == nullptr && f == nullptr)
 				{
 					error("Cannot initialize global '{0}' with a non-constant!",
 					      node->decl.name);
 					return nullptr;
 				}
+
+				if(f != nullptr)
+					initializer = llvm::ConstantFP::get(type, f->value);
+				else if(type->isFloatingPointTy())
+					initializer = llvm::ConstantFP::get(
+					    type, isSignedNumericType(n->numeric) ? double(std::int64_t(n->value))
+					                                          : double(n->value));
+				else
+					initializer = llvm::ConstantExpr::getIntegerCast(
+					    llvm::cast<llvm::Constant>(n->impl_->gen(env)), type,
+					    isSignedNumericType(n->numeric));
 			}
+			else if(node->decl.type->type == TypeType::structural)
+				initializer = llvm::Constant::getNullValue(type);
 
-			auto *g = new llvm::GlobalVariable(
-			    *env.codeModule, convertTypeToLLVMType(env, node->decl.type), false,
-			    llvm::GlobalVariable::ExternalLinkage, initializer, node->decl.name);
+			auto linkage = node->decl.exported ? llvm::GlobalVariable::ExternalLinkage
+			                                   : llvm::GlobalVariable::InternalLinkage;
+			auto *g = new llvm::GlobalVariable(*env.codeModule, type, node->decl.constant,
+			                                   linkage, initializer, node->decl.name);
+			if(auto align = getStructAlignment(node->decl.type))
+				g->setAlignment(*align);
 
 			env.baseEnv.front().set<Global>(node->decl.name, g);
 			return g;
@@ -224,7 +909,30 @@ namespace noct
 
 	struct ASTIdnImpl : ASTImpl
 	{
+		ASTIdn *node;
+
+		ASTIdnImpl(ASTIdn *node) : node(node) {}
 
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *v = env.lookup(node->name);
+			if(auto l = dynamic_cast<Local *>(v); l != nullptr)
+				return env.readVariable(l, env.builder.GetInsertBlock());
+
+			// The global may have been emitted into an earlier module, so refer to it
+			// through the current one. An array or a struct is used by address.
+			if(auto g = dynamic_cast<Global *>(v); g != nullptr && isInPlace(node->checkedType))
+				return env.codeModule->getOrInsertGlobal(node->name, g->llvmType);
+			if(auto g = dynamic_cast<Global *>(v); g != nullptr)
+				return env.builder.CreateLoad(
+				    g->llvmType, env.codeModule->getOrInsertGlobal(node->name, g->llvmType),
+				    node->name);
+
+			error("Unknown variable '{0}'!", node->name);
+			return nullptr;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override {}
 	};
 
 	struct ASTFuncImpl : ASTImpl
@@ -238,11 +946,51 @@ namespace noct
 			llvm::Function   *f = generateFunctionProto(env, node->decl);
 			llvm::BasicBlock *bb = llvm::BasicBlock::Create(env.context, "entry", f);
 			env.builder.SetInsertPoint(bb);
+			env.sealBlock(bb);
 
 			if(auto b = dynamic_cast<ASTBlock *>(node->body.get()); b != nullptr)
 			{
-				auto retValue = b->impl_->gen(env);
+				generateFunctionAttributes(env, f, node->decl);
+				generatePointerParams(env, f, node);
+
+				// Strict IEEE unless the function says otherwise; the builder puts the
+				// flags on every floating-point instruction it makes.
+				env.builder.setFastMathFlags(
+				    convertFastMathFlags(*getFastMathFlags(node->decl.attributes)));
+
+				auto &scope = env.baseEnv.emplace_back();
+				scope.isFunc = true;
+				for(std::size_t i = 0, a = 0; i < node->decl.argNames.size(); ++i)
+				{
+					const auto  &type = node->decl.signature.argTypes[i];
+					llvm::Value *arg = f->getArg(a++);
+					if(dynamic_cast<TypeSlice *>(type.get()) != nullptr)
+					{
+						auto *slice = llvm::PoisonValue::get(convertTypeToLLVMType(env, type));
+						arg = env.builder.CreateInsertValue(
+						    env.builder.CreateInsertValue(slice, arg, 0), f->getArg(a++), 1);
+					}
+					scope.set<Local>(node->decl.argNames[i], arg->getType());
+					env.writeVariable(static_cast<Local *>(scope.get(node->decl.argNames[i])),
+					                  bb, arg);
+				}
+
+				auto retValue = convertValue(env, b->impl_->gen(env), b->checkedType,
+				                             node->decl.signature.returnType);
 				env.builder.CreateRet(retValue);
+
+				env.baseEnv.pop_back();
+				env.builder.clearFastMathFlags();
+				env.aliasScopes.clear();
+				env.currentDef.clear();
+				env.incompletePhis.clear();
+				env.sealedBlocks.clear();
+
+				if(node->decl.hasAttribute("flatten"))
+					flattenCalls(f);
+				if(env.instrumentFunctions)
+					instrumentFunction(env, f);
+
 				llvm::verifyFunction(*f);
 
 				return f;
@@ -267,10 +1015,25 @@ namespace noct
 
 		llvm::Value *gen(GeneratorImpl &env) const noexcept override
 		{
+			// A @fastmath block adds to what the code around it allows, up to its end.
+			llvm::IRBuilderBase::FastMathFlagGuard guard(env.builder);
+			if(auto flags = *getFastMathFlags(node->attributes); flags != 0)
+			{
+				auto f = env.builder.getFastMathFlags();
+				f |= convertFastMathFlags(flags);
+				env.builder.setFastMathFlags(f);
+			}
+
+			bool wasCold = env.cold;
+			env.cold = env.cold || node->isCold();
+			env.baseEnv.emplace_back();
+
 			llvm::Value *last = nullptr;
 			for(const auto &n : node->nodes)
 				last = n->impl_->gen(env);
 
+			env.baseEnv.pop_back();
+			env.cold = wasCold;
 			return last;
 		}
 
@@ -281,6 +1044,787 @@ namespace noct
 		}
 	};
 
+	struct ASTAssignImpl : ASTImpl
+	{
+		ASTAssign *node;
+
+		ASTAssignImpl(ASTAssign *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *v = env.lookup(node->name);
+			if(v == nullptr)
+			{
+				error("Unknown variable '{0}'!", node->name);
+				return nullptr;
+			}
+
+			auto *l = dynamic_cast<Local *>(v);
+			auto *global = l == nullptr ? env.codeModule->getOrInsertGlobal(node->name, v->llvmType)
+			                            : nullptr;
+
+			auto *value = convertValue(env, node->value->impl_->gen(env),
+			                           node->value->checkedType, node->checkedType);
+
+			auto *stored = value;
+			if(!node->field.empty())
+			{
+				// A field is stored in place, of the struct or of an element.
+				llvm::Value *base = global;
+				if(l != nullptr)
+					base = env.readVariable(l, env.builder.GetInsertBlock());
+				else if(!isInPlace(node->target))
+					base = env.builder.CreateLoad(v->llvmType, global, node->name);
+				auto *index = node->index != nullptr ? node->index->impl_->gen(env) : nullptr;
+
+				auto [field, align] = generateFieldPointer(
+				    env, base, node->target, index,
+				    node->index != nullptr ? node->index->checkedType : nullptr,
+				    node->boundsChecked, node->fieldIndex);
+				annotateAccess(env, env.builder.CreateAlignedStore(value, field, align),
+				               node->name);
+				return value;
+			}
+			if(node->index != nullptr)
+			{
+				llvm::Value *current = global;
+				if(l != nullptr)
+					current = env.readVariable(l, env.builder.GetInsertBlock());
+				else if(dynamic_cast<TypeArray *>(node->target.get()) == nullptr)
+					current = env.builder.CreateLoad(v->llvmType, global, node->name);
+				auto *index = node->index->impl_->gen(env);
+
+				// An element is stored in place; a lane is written by replacing the
+				// whole vector.
+				if(node->target->type == TypeType::structural)
+				{
+					annotateAccess(
+					    env,
+					    env.builder.CreateStore(
+					        value, generateElementPointer(env, current, node->target, index,
+					                                      node->index->checkedType,
+					                                      node->boundsChecked)),
+					    node->name);
+					return value;
+				}
+				stored = env.builder.CreateInsertElement(current, value,
+				                                         wrapLaneIndex(env, current, index));
+			}
+
+			if(l != nullptr)
+				env.writeVariable(l, env.builder.GetInsertBlock(), stored);
+			else
+				env.builder.CreateStore(stored, global);
+			return value;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			if(node->index != nullptr)
+				env.provideImpls(node->index.get());
+			env.provideImpls(node->value.get());
+		}
+	};
+
+	struct ASTIndexImpl : ASTImpl
+	{
+		ASTIndex *node;
+
+		ASTIndexImpl(ASTIndex *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *base = node->base->impl_->gen(env);
+			auto *index = node->index->impl_->gen(env);
+			if(node->base->checkedType->type == TypeType::vector)
+				return env.builder.CreateExtractElement(base, wrapLaneIndex(env, base, index));
+
+			auto *element = generateElementPointer(env, base, node->base->checkedType, index,
+			                                       node->index->checkedType, node->boundsChecked);
+			auto *load = env.builder.CreateLoad(convertTypeToLLVMType(env, node->checkedType),
+			                                    element);
+			auto *idn = dynamic_cast<ASTIdn *>(node->base.get());
+			annotateAccess(env, load, idn != nullptr ? idn->name : std::string());
+			return load;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->base.get());
+			env.provideImpls(node->index.get());
+		}
+	};
+
+	struct ASTFieldImpl : ASTImpl
+	{
+		ASTField *node;
+
+		ASTFieldImpl(ASTField *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			// Of an element, the element itself is never loaded.
+			auto *element = dynamic_cast<ASTIndex *>(node->base.get());
+			auto *target = element != nullptr ? element->base.get() : node->base.get();
+			auto *base = target->impl_->gen(env);
+			auto *index = element != nullptr ? element->index->impl_->gen(env) : nullptr;
+
+			auto [field, align] = generateFieldPointer(
+			    env, base, target->checkedType, index,
+			    element != nullptr ? element->index->checkedType : nullptr,
+			    element != nullptr && element->boundsChecked, node->fieldIndex);
+			auto *load = env.builder.CreateAlignedLoad(
+			    convertTypeToLLVMType(env, node->checkedType), field, align);
+			auto *idn = dynamic_cast<ASTIdn *>(target);
+			annotateAccess(env, load, idn != nullptr ? idn->name : std::string());
+			return load;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->base.get());
+		}
+	};
+
+	// Both arms branch to the merge block, whose phi is the value of the if.
+	struct ASTIfImpl : ASTImpl
+	{
+		ASTIf *node;
+
+		ASTIfImpl(ASTIf *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *f = env.builder.GetInsertBlock()->getParent();
+			auto *cond = env.builder.CreateIsNotNull(node->cond->impl_->gen(env));
+
+			auto *thenBlock = llvm::BasicBlock::Create(env.context, "then", f);
+			auto *elseBlock = llvm::BasicBlock::Create(env.context, "else", f);
+			auto *mergeBlock = llvm::BasicBlock::Create(env.context, "endif", f);
+			env.builder.CreateCondBr(
+			    cond, thenBlock, elseBlock,
+			    createExpectedBranchWeights(env, getExpectedBranch(node->cond.get(),
+			                                                       node->then.get(),
+			                                                       node->otherwise.get())));
+			env.sealBlock(thenBlock);
+			env.sealBlock(elseBlock);
+
+			auto *type = convertTypeToLLVMType(env, node->checkedType);
+			bool  hasValue = type != nullptr && !type->isVoidTy();
+
+			auto arm = [&](llvm::BasicBlock *block, const Ptr<AST> &body) {
+				env.builder.SetInsertPoint(block);
+				llvm::Value *v = body != nullptr ? body->impl_->gen(env) : nullptr;
+				if(hasValue)
+					v = convertValue(env, v, body->checkedType, node->checkedType);
+				env.builder.CreateBr(mergeBlock);
+				return std::make_pair(v, env.builder.GetInsertBlock());
+			};
+
+			auto [thenValue, thenEnd] = arm(thenBlock, node->then);
+			auto [elseValue, elseEnd] = arm(elseBlock, node->otherwise);
+			env.sealBlock(mergeBlock);
+			env.builder.SetInsertPoint(mergeBlock);
+
+			if(!hasValue)
+				return nullptr;
+
+			auto *phi = env.builder.CreatePHI(type, 2);
+			phi->addIncoming(thenValue, thenEnd);
+			phi->addIncoming(elseValue, elseEnd);
+			return phi;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->cond.get());
+			env.provideImpls(node->then.get());
+			if(node->otherwise != nullptr)
+				env.provideImpls(node->otherwise.get());
+		}
+	};
+
+	// The header stays unsealed until the body has branched back to it.
+	struct ASTWhileImpl : ASTImpl
+	{
+		ASTWhile *node;
+
+		ASTWhileImpl(ASTWhile *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *f = env.builder.GetInsertBlock()->getParent();
+			auto *headerBlock = llvm::BasicBlock::Create(env.context, "while", f);
+			auto *bodyBlock = llvm::BasicBlock::Create(env.context, "body", f);
+			auto *exitBlock = llvm::BasicBlock::Create(env.context, "endwhile", f);
+
+			env.builder.CreateBr(headerBlock);
+			env.builder.SetInsertPoint(headerBlock);
+			auto *cond = env.builder.CreateIsNotNull(node->cond->impl_->gen(env));
+			env.builder.CreateCondBr(
+			    cond, bodyBlock, exitBlock,
+			    createExpectedBranchWeights(
+			        env, getExpectedBranch(node->cond.get(), nullptr, nullptr)));
+			env.sealBlock(bodyBlock);
+			env.sealBlock(exitBlock);
+
+			env.builder.SetInsertPoint(bodyBlock);
+			node->body->impl_->gen(env);
+			env.builder.CreateBr(headerBlock);
+			env.sealBlock(headerBlock);
+
+			env.builder.SetInsertPoint(exitBlock);
+			return nullptr;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->cond.get());
+			env.provideImpls(node->body.get());
+		}
+	};
+
+	// The identity of the operator of a parallel reduction, in every lane.
+	llvm::Constant *getReductionIdentity(llvm::Type *type, char op)
+	{
+		if(op == '*')
+			return llvm::ConstantInt::get(type, 1);
+		if(op == '&')
+			return llvm::Constant::getAllOnesValue(type);
+		return llvm::Constant::getNullValue(type);
+	}
+
+	// Wrapping even where the operator would not be: a partial result can overflow
+	// where the whole does not.
+	llvm::Value *generateReductionStep(GeneratorImpl &env, char op, llvm::Value *l,
+	                                   llvm::Value *r)
+	{
+		switch(op)
+		{
+		case '+':
+			return env.builder.CreateAdd(l, r);
+		case '*':
+			return env.builder.CreateMul(l, r);
+		case '&':
+			return env.builder.CreateAnd(l, r);
+		case '|':
+			return env.builder.CreateOr(l, r);
+		default:
+			return env.builder.CreateXor(l, r);
+		}
+	}
+
+	// The body becomes a function of its own, `void body(i8 *ctx, i64 begin, i64 end,
+	// i8 *acc)`, that runs the iterations in [begin, end) and, of a reduction, stores
+	// their combined value to acc. runtime/parallel.cpp splits the range between its
+	// threads. The locals the body uses are copied into ctx: the typechecker only lets
+	// it write through them, so the copies see every write.
+	struct ASTParallelImpl : ASTImpl
+	{
+		ASTParallel *node;
+
+		ASTParallelImpl(ASTParallel *node) : node(node) {}
+
+		// The locals of the enclosing function that the body names, in the order it
+		// first does. One it declares itself may be among them, which costs a copy.
+		auto collectCaptures(GeneratorImpl &env) const
+		    -> std::vector<std::pair<std::string, Local *>>
+		{
+			std::vector<std::pair<std::string, Local *>> captures;
+			std::function<void(AST *)> visit = [&](AST *n) {
+				const std::string *name = nullptr;
+				if(auto i = dynamic_cast<ASTIdn *>(n); i != nullptr)
+					name = &i->name;
+				else if(auto a = dynamic_cast<ASTAssign *>(n); a != nullptr)
+					name = &a->name;
+
+				auto *l = name != nullptr ? dynamic_cast<Local *>(env.lookup(*name)) : nullptr;
+				if(l != nullptr
+				   && std::find_if(captures.begin(), captures.end(), [&](const auto &c) {
+					      return c.second == l;
+				      }) == captures.end())
+					captures.emplace_back(*name, l);
+				forEachChild(n, visit);
+			};
+			visit(node->body.get());
+			return captures;
+		}
+
+		llvm::Function *generateBody(GeneratorImpl &env,
+		                             const std::vector<std::pair<std::string, Local *>> &captures,
+		                             llvm::StructType *ctxType, llvm::Type *accType) const
+		{
+			llvm::IRBuilderBase::InsertPointGuard guard(env.builder);
+			auto *i8p = env.builder.getInt8PtrTy();
+			auto *i64 = env.builder.getInt64Ty();
+			auto *parent = env.builder.GetInsertBlock()->getParent();
+			auto *f = llvm::Function::Create(
+			    llvm::FunctionType::get(env.builder.getVoidTy(), {i8p, i64, i64, i8p}, false),
+			    llvm::Function::InternalLinkage, parent->getName() + ".parallel",
+			    env.codeModule.get());
+			f->addFnAttr(llvm::Attribute::NoUnwind);
+
+			auto *entryBlock = llvm::BasicBlock::Create(env.context, "entry", f);
+			auto *headerBlock = llvm::BasicBlock::Create(env.context, "parallel", f);
+			auto *bodyBlock = llvm::BasicBlock::Create(env.context, "body", f);
+			auto *exitBlock = llvm::BasicBlock::Create(env.context, "endparallel", f);
+			env.builder.SetInsertPoint(entryBlock);
+			env.sealBlock(entryBlock);
+
+			auto &scope = env.baseEnv.emplace_back();
+			auto *ctx = env.builder.CreatePointerCast(f->getArg(0), ctxType->getPointerTo());
+			for(unsigned i = 0; i < captures.size(); ++i)
+			{
+				const auto &name = captures[i].first;
+				auto *type = ctxType->getElementType(i);
+				scope.set<Local>(name, type);
+				env.writeVariable(static_cast<Local *>(scope.get(name)), entryBlock,
+				                  env.builder.CreateLoad(
+				                      type, env.builder.CreateStructGEP(ctxType, ctx, i), name));
+			}
+			env.builder.CreateBr(headerBlock);
+
+			// Like a while loop, with the index and the result so far as phis of
+			// their own: neither is a variable of the program.
+			env.builder.SetInsertPoint(headerBlock);
+			auto *index = env.builder.CreatePHI(i64, 2, node->var);
+			auto *acc = accType != nullptr ? env.builder.CreatePHI(accType, 2, "acc") : nullptr;
+			env.builder.CreateCondBr(env.builder.CreateICmpSLT(index, f->getArg(2)), bodyBlock,
+			                         exitBlock);
+			env.sealBlock(bodyBlock);
+			env.sealBlock(exitBlock);
+
+			env.builder.SetInsertPoint(bodyBlock);
+			auto &iteration = env.baseEnv.emplace_back();
+			auto *varType = convertTypeToLLVMType(env, node->varType);
+			iteration.set<Local>(node->var, varType);
+			env.writeVariable(static_cast<Local *>(iteration.get(node->var)), bodyBlock,
+			                  env.builder.CreateIntCast(index, varType, false));
+			auto *value = node->body->impl_->gen(env);
+			env.baseEnv.pop_back();
+			env.baseEnv.pop_back();
+
+			auto *latchBlock = env.builder.GetInsertBlock();
+			if(acc != nullptr)
+			{
+				acc->addIncoming(getReductionIdentity(accType, node->op), entryBlock);
+				acc->addIncoming(
+				    generateReductionStep(env, node->op, acc,
+				                          convertValue(env, value, node->body->checkedType,
+				                                       node->checkedType)),
+				    latchBlock);
+			}
+			// No wrap: the index stays below end, an i64 itself.
+			auto *next = env.builder.CreateAdd(index, env.builder.getInt64(1), "", false, true);
+			env.builder.CreateBr(headerBlock);
+			index->addIncoming(f->getArg(1), entryBlock);
+			index->addIncoming(next, latchBlock);
+			env.sealBlock(headerBlock);
+
+			env.builder.SetInsertPoint(exitBlock);
+			if(acc != nullptr)
+				env.builder.CreateStore(
+				    acc, env.builder.CreatePointerCast(f->getArg(3), accType->getPointerTo()));
+			env.builder.CreateRetVoid();
+
+			llvm::verifyFunction(*f);
+			return f;
+		}
+
+		// `void combine(i8 *acc, i8 *other)`: *acc = *acc op *other, for the runtime
+		// to merge what its threads got.
+		llvm::Function *generateCombine(GeneratorImpl &env, llvm::Type *type) const
+		{
+			llvm::IRBuilderBase::InsertPointGuard guard(env.builder);
+			auto *i8p = env.builder.getInt8PtrTy();
+			auto *parent = env.builder.GetInsertBlock()->getParent();
+			auto *f = llvm::Function::Create(
+			    llvm::FunctionType::get(env.builder.getVoidTy(), {i8p, i8p}, false),
+			    llvm::Function::InternalLinkage, parent->getName() + ".combine",
+			    env.codeModule.get());
+			f->addFnAttr(llvm::Attribute::NoUnwind);
+
+			env.builder.SetInsertPoint(llvm::BasicBlock::Create(env.context, "entry", f));
+			auto *acc = env.builder.CreatePointerCast(f->getArg(0), type->getPointerTo());
+			auto *other = env.builder.CreatePointerCast(f->getArg(1), type->getPointerTo());
+			env.builder.CreateStore(generateReductionStep(env, node->op,
+			                                              env.builder.CreateLoad(type, acc),
+			                                              env.builder.CreateLoad(type, other)),
+			                        acc);
+			env.builder.CreateRetVoid();
+			return f;
+		}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			// The bounds go to the runtime as i64s, whatever the type of the index.
+			auto bound = [&](const Ptr<AST> &n) {
+				auto *v = convertValue(env, n->impl_->gen(env), n->checkedType, node->varType);
+				return env.builder.CreateIntCast(
+				    v, env.builder.getInt64Ty(),
+				    isSignedNumericType(getElementNumericType(node->varType)));
+			};
+			auto *lo = bound(node->lo);
+			auto *hi = bound(node->hi);
+
+			auto                       captures = collectCaptures(env);
+			std::vector<llvm::Value *> values;
+			std::vector<llvm::Type *>  types;
+			for(const auto &[name, l] : captures)
+			{
+				values.push_back(env.readVariable(l, env.builder.GetInsertBlock()));
+				types.push_back(values.back()->getType());
+			}
+			auto *ctxType = llvm::StructType::get(env.context, types);
+			auto *accType = node->op != 0 ? convertTypeToLLVMType(env, node->checkedType)
+			                              : nullptr;
+			auto *body = generateBody(env, captures, ctxType, accType);
+
+			auto &entry = env.builder.GetInsertBlock()->getParent()->getEntryBlock();
+			llvm::IRBuilder<> top(&entry, entry.begin());
+			auto *ctx = top.CreateAlloca(ctxType, nullptr, "parallel.ctx");
+			for(unsigned i = 0; i < values.size(); ++i)
+				env.builder.CreateStore(values[i], env.builder.CreateStructGEP(ctxType, ctx, i));
+
+			auto *i8p = env.builder.getInt8PtrTy();
+			auto *i64 = env.builder.getInt64Ty();
+			auto *rawCtx = env.builder.CreatePointerCast(ctx, i8p);
+			if(accType == nullptr)
+			{
+				auto run = env.codeModule->getOrInsertFunction(
+				    "__noct_parallel_for", env.builder.getVoidTy(), body->getType(), i8p, i64, i64);
+				env.builder.CreateCall(run, {body, rawCtx, lo, hi});
+				return nullptr;
+			}
+
+			auto *combine = generateCombine(env, accType);
+			auto *result = top.CreateAlloca(accType, nullptr, "parallel.result");
+			env.builder.CreateStore(getReductionIdentity(accType, node->op), result);
+			auto run = env.codeModule->getOrInsertFunction(
+			    "__noct_parallel_reduce", env.builder.getVoidTy(), body->getType(),
+			    combine->getType(), i8p, i64, i64, i8p, i64);
+			env.builder.CreateCall(run, {body, combine, rawCtx, lo, hi,
+			                             env.builder.CreatePointerCast(result, i8p),
+			                             env.builder.getInt64(node->checkedType->size())});
+			return env.builder.CreateLoad(accType, result);
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->lo.get());
+			env.provideImpls(node->hi.get());
+			env.provideImpls(node->body.get());
+		}
+	};
+
+	struct ASTBinaryImpl : ASTImpl
+	{
+		ASTBinary *node;
+
+		ASTBinaryImpl(ASTBinary *node) : node(node) {}
+
+		// The right side only runs when the left one has not decided the result.
+		llvm::Value *genLogical(GeneratorImpl &env) const noexcept
+		{
+			bool isAnd = node->op == TokenType::opr_d_amp;
+			auto *f = env.builder.GetInsertBlock()->getParent();
+
+			auto *lhs = env.builder.CreateIsNotNull(node->lhs->impl_->gen(env));
+			auto *lhsEnd = env.builder.GetInsertBlock();
+			auto *rhsBlock = llvm::BasicBlock::Create(env.context, isAnd ? "and" : "or", f);
+			auto *mergeBlock = llvm::BasicBlock::Create(env.context, "endlogical", f);
+			if(isAnd)
+				env.builder.CreateCondBr(lhs, rhsBlock, mergeBlock);
+			else
+				env.builder.CreateCondBr(lhs, mergeBlock, rhsBlock);
+			env.sealBlock(rhsBlock);
+
+			env.builder.SetInsertPoint(rhsBlock);
+			auto *rhs = env.builder.CreateIsNotNull(node->rhs->impl_->gen(env));
+			auto *rhsEnd = env.builder.GetInsertBlock();
+			env.builder.CreateBr(mergeBlock);
+			env.sealBlock(mergeBlock);
+
+			env.builder.SetInsertPoint(mergeBlock);
+			auto *phi = env.builder.CreatePHI(env.builder.getInt1Ty(), 2);
+			phi->addIncoming(env.builder.getInt1(!isAnd), lhsEnd);
+			phi->addIncoming(rhs, rhsEnd);
+			return env.builder.CreateZExt(phi, convertTypeToLLVMType(env, node->checkedType));
+		}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			if(node->op == TokenType::opr_d_amp || node->op == TokenType::opr_d_bar)
+				return genLogical(env);
+
+			auto *l = convertValue(env, node->lhs->impl_->gen(env), node->lhs->checkedType,
+			                       node->operandType);
+			auto *r = convertValue(env, node->rhs->impl_->gen(env), node->rhs->checkedType,
+			                       node->operandType);
+
+			auto type = getElementNumericType(node->operandType);
+			bool isSigned = isSignedNumericType(type);
+			bool isFloat = isFloatingNumericType(type);
+
+			// Scalars compare to 0 or 1, vector lanes to all zeros or all ones.
+			auto compare = [&](llvm::CmpInst::Predicate s, llvm::CmpInst::Predicate u,
+			                   llvm::CmpInst::Predicate f) {
+				auto *result = convertTypeToLLVMType(env, node->checkedType);
+				auto *c = isFloat ? env.builder.CreateFCmp(f, l, r)
+				                  : env.builder.CreateICmp(isSigned ? s : u, l, r);
+				return result->isVectorTy() ? env.builder.CreateSExt(c, result)
+				                            : env.builder.CreateZExt(c, result);
+			};
+
+			// Overflow is undefined unless the operator says otherwise, which lets
+			// loops widen and strength-reduce their induction variables.
+			switch(node->op)
+			{
+			case '+':
+				return isFloat ? env.builder.CreateFAdd(l, r)
+				               : env.builder.CreateAdd(l, r, "", !isSigned, isSigned);
+			case '-':
+				return isFloat ? env.builder.CreateFSub(l, r)
+				               : env.builder.CreateSub(l, r, "", !isSigned, isSigned);
+			case '*':
+				return isFloat ? env.builder.CreateFMul(l, r)
+				               : env.builder.CreateMul(l, r, "", !isSigned, isSigned);
+			case TokenType::opr_wradd:
+				return env.builder.CreateAdd(l, r);
+			case TokenType::opr_wrsub:
+				return env.builder.CreateSub(l, r);
+			case TokenType::opr_wrmul:
+				return env.builder.CreateMul(l, r);
+			case TokenType::opr_chadd:
+				return generateCheckedArithmetic(
+				    env, isSigned ? llvm::Intrinsic::sadd_with_overflow
+				                  : llvm::Intrinsic::uadd_with_overflow,
+				    l, r);
+			case TokenType::opr_chsub:
+				return generateCheckedArithmetic(
+				    env, isSigned ? llvm::Intrinsic::ssub_with_overflow
+				                  : llvm::Intrinsic::usub_with_overflow,
+				    l, r);
+			case TokenType::opr_chmul:
+				return generateCheckedArithmetic(
+				    env, isSigned ? llvm::Intrinsic::smul_with_overflow
+				                  : llvm::Intrinsic::umul_with_overflow,
+				    l, r);
+			case '/':
+				if(isFloat)
+					return env.builder.CreateFDiv(l, r);
+				return isSigned ? env.builder.CreateSDiv(l, r) : env.builder.CreateUDiv(l, r);
+			case '%':
+				if(isFloat)
+					return env.builder.CreateFRem(l, r);
+				return isSigned ? env.builder.CreateSRem(l, r) : env.builder.CreateURem(l, r);
+			case '&':
+				return env.builder.CreateAnd(l, r);
+			case '|':
+				return env.builder.CreateOr(l, r);
+			case '^':
+				return env.builder.CreateXor(l, r);
+			case TokenType::opr_shftl:
+				return env.builder.CreateShl(l, r);
+			case TokenType::opr_shftr:
+				return isSigned ? env.builder.CreateAShr(l, r) : env.builder.CreateLShr(l, r);
+			case '<':
+				return compare(llvm::CmpInst::ICMP_SLT, llvm::CmpInst::ICMP_ULT,
+				               llvm::CmpInst::FCMP_OLT);
+			case '>':
+				return compare(llvm::CmpInst::ICMP_SGT, llvm::CmpInst::ICMP_UGT,
+				               llvm::CmpInst::FCMP_OGT);
+			case TokenType::opr_lteql:
+				return compare(llvm::CmpInst::ICMP_SLE, llvm::CmpInst::ICMP_ULE,
+				               llvm::CmpInst::FCMP_OLE);
+			case TokenType::opr_gteql:
+				return compare(llvm::CmpInst::ICMP_SGE, llvm::CmpInst::ICMP_UGE,
+				               llvm::CmpInst::FCMP_OGE);
+			case TokenType::opr_equal:
+				return compare(llvm::CmpInst::ICMP_EQ, llvm::CmpInst::ICMP_EQ,
+				               llvm::CmpInst::FCMP_OEQ);
+			case TokenType::opr_noteq:
+				return compare(llvm::CmpInst::ICMP_NE, llvm::CmpInst::ICMP_NE,
+				               llvm::CmpInst::FCMP_UNE);
+			default:
+				error("Unknown binary operator '{0}'!", (int)node->op);
+				return nullptr;
+			}
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->lhs.get());
+			env.provideImpls(node->rhs.get());
+		}
+	};
+
+	struct ASTUnaryImpl : ASTImpl
+	{
+		ASTUnary *node;
+
+		ASTUnaryImpl(ASTUnary *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			auto *v = node->operand->impl_->gen(env);
+			switch(node->op)
+			{
+			case '-':
+				if(v->getType()->isFPOrFPVectorTy())
+					return env.builder.CreateFNeg(v);
+				return env.builder.CreateNeg(v);
+			case '~':
+				return env.builder.CreateNot(v);
+			case '!':
+				return env.builder.CreateZExt(env.builder.CreateIsNull(v),
+				                              convertTypeToLLVMType(env, node->checkedType));
+			default:
+				error("Unknown unary operator '{0}'!", node->op);
+				return nullptr;
+			}
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			env.provideImpls(node->operand.get());
+		}
+	};
+
+	struct ASTCallImpl : ASTImpl
+	{
+		ASTCall *node;
+
+		ASTCallImpl(ASTCall *node) : node(node) {}
+
+		// Vector construction, shuffles, reductions and branch hints, as single
+		// instructions or LLVM intrinsics.
+		llvm::Value *genBuiltin(GeneratorImpl &env) const noexcept
+		{
+			std::vector<llvm::Value *> args;
+			for(const auto &a : node->args) args.push_back(a->impl_->gen(env));
+
+			if(node->builtin == Builtin::len)
+			{
+				if(auto a = dynamic_cast<TypeArray *>(node->args[0]->checkedType.get()))
+					return env.builder.getInt64(a->count);
+				return env.builder.CreateExtractValue(args[0], 1);
+			}
+
+			// The hint is for branches on the result; llvm.expect also carries it
+			// through code that merely computes the condition.
+			if(node->builtin == Builtin::likely || node->builtin == Builtin::unlikely)
+			{
+				auto *c = env.builder.CreateIntrinsic(
+				    llvm::Intrinsic::expect, {env.builder.getInt1Ty()},
+				    {env.builder.CreateIsNotNull(args[0]),
+				     env.builder.getInt1(node->builtin == Builtin::likely)});
+				return env.builder.CreateZExt(c, env.builder.getInt32Ty());
+			}
+
+			if(node->builtin == Builtin::vector)
+			{
+				if(args.size() == 1)
+					return convertValue(env, args[0], node->args[0]->checkedType,
+					                    node->checkedType);
+
+				auto element = makePtr<TypeNumeric>(getElementNumericType(node->checkedType));
+				llvm::Value *v = llvm::PoisonValue::get(convertTypeToLLVMType(env, node->checkedType));
+				for(std::size_t i = 0; i < args.size(); ++i)
+					v = env.builder.CreateInsertElement(
+					    v, convertValue(env, args[i], node->args[i]->checkedType, element), i);
+				return v;
+			}
+
+			if(node->builtin == Builtin::shuffle)
+			{
+				std::size_t first = args.size() > 1 && args[1]->getType()->isVectorTy() ? 2 : 1;
+				std::vector<int> mask;
+				for(std::size_t i = first; i < node->args.size(); ++i)
+					mask.push_back(int(static_cast<ASTInt *>(node->args[i].get())->value));
+
+				auto *second = first == 2 ? args[1] : llvm::PoisonValue::get(args[0]->getType());
+				return env.builder.CreateShuffleVector(args[0], second, mask);
+			}
+
+			auto  type = getElementNumericType(node->args[0]->checkedType);
+			auto *element = convertNumericTypeToLLVMType(env.context, type);
+			bool  isSigned = isSignedNumericType(type);
+			bool  isFloat = isFloatingNumericType(type);
+			auto *v = args[0];
+
+			switch(node->builtin)
+			{
+			case Builtin::reduceAdd:
+				return isFloat ? env.builder.CreateFAddReduce(
+				                     llvm::ConstantFP::getNegativeZero(element), v)
+				               : env.builder.CreateAddReduce(v);
+			case Builtin::reduceMul:
+				return isFloat ? env.builder.CreateFMulReduce(llvm::ConstantFP::get(element, 1.0), v)
+				               : env.builder.CreateMulReduce(v);
+			case Builtin::reduceMin:
+				return isFloat ? env.builder.CreateFPMinReduce(v)
+				               : env.builder.CreateIntMinReduce(v, isSigned);
+			case Builtin::reduceMax:
+				return isFloat ? env.builder.CreateFPMaxReduce(v)
+				               : env.builder.CreateIntMaxReduce(v, isSigned);
+			case Builtin::reduceAnd:
+				return env.builder.CreateAndReduce(v);
+			case Builtin::reduceOr:
+				return env.builder.CreateOrReduce(v);
+			case Builtin::reduceXor:
+				return env.builder.CreateXorReduce(v);
+			default:
+				error("Unknown builtin '{0}'!", node->name);
+				return nullptr;
+			}
+		}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			if(node->builtin != Builtin::none)
+				return genBuiltin(env);
+
+			const auto &signature = node->callee->signature;
+			auto        callee = env.codeModule->getOrInsertFunction(
+			           node->name, convertSignatureToLLVMType(env, signature));
+
+			std::vector<llvm::Value *> args;
+			for(std::size_t i = 0; i < node->args.size(); ++i)
+			{
+				auto *v = convertValue(env, node->args[i]->impl_->gen(env),
+				                       node->args[i]->checkedType, signature.argTypes[i]);
+				if(dynamic_cast<TypeSlice *>(signature.argTypes[i].get()) != nullptr)
+				{
+					args.push_back(env.builder.CreateExtractValue(v, 0));
+					args.push_back(env.builder.CreateExtractValue(v, 1));
+				}
+				else
+					args.push_back(v);
+			}
+
+			auto *call = env.builder.CreateCall(callee, args);
+			if(auto *f = llvm::dyn_cast<llvm::Function>(callee.getCallee()))
+				call->setCallingConv(f->getCallingConv());
+
+			// On the call too: the callee may be a bare declaration from an earlier module.
+			for(auto kind : getPurityAttributes(env, node->callee->purity))
+				call->addFnAttr(kind);
+			if(env.cold)
+			{
+				call->addFnAttr(llvm::Attribute::Cold);
+				env.hasColdCode = true;
+			}
+			return call;
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override
+		{
+			for(const auto &a : node->args)
+				env.provideImpls(a.get());
+		}
+	};
+
 	struct ASTIntImpl : ASTImpl
 	{
 		ASTInt *node;
@@ -289,18 +1833,43 @@ namespace noct
 
 		llvm::Value *gen(GeneratorImpl &env) const noexcept override
 		{
-			auto t = getSuitableIntegerTypeFor(node->value);
-			return llvm::ConstantInt::get(convertNumericTypeToLLVMType(env.context, t),
-			                              node->value, isSignedNumericType(t));
+			return llvm::ConstantInt::get(
+			    convertNumericTypeToLLVMType(env.context, node->numeric), node->value,
+			    isSignedNumericType(node->numeric));
+		}
+
+		void provideImpls(GeneratorImpl &env) const noexcept override {}
+	};
+
+	struct ASTFloatImpl : ASTImpl
+	{
+		ASTFloat *node;
+
+		ASTFloatImpl(ASTFloat *node) : node(node) {}
+
+		llvm::Value *gen(GeneratorImpl &env) const noexcept override
+		{
+			return llvm::ConstantFP::get(convertNumericTypeToLLVMType(env.context, node->numeric),
+			                             node->value);
 		}
 
 		void provideImpls(GeneratorImpl &env) const noexcept override {}
 	};
 
 	GeneratorImpl::GeneratorImpl(const std::string &moduleName)
-		: moduleName(moduleName), builder(context)
+		: moduleName(moduleName), ownedContext(std::make_unique<llvm::LLVMContext>()),
+		  context(*ownedContext), builder(context)
+	{
+		codeModule = std::make_unique<llvm::Module>(moduleName, context);
+		baseEnv.emplace_back();
+	}
+
+	GeneratorImpl::GeneratorImpl(const std::string &moduleName,
+	                             llvm::LLVMContext &context)
+		: moduleName(moduleName), context(context), builder(context)
 	{
 		codeModule = std::make_unique<llvm::Module>(moduleName, context);
+		baseEnv.emplace_back();
 	}
 
 	void GeneratorImpl::generateFunction(ASTFunc *func)
@@ -315,7 +1884,66 @@ namespace noct
 		auto g = (llvm::GlobalVariable *)var->impl_->gen(*this);
 	}
 
-	void GeneratorImpl::output()
+	bool GeneratorImpl::optimize(llvm::TargetMachine *machine)
+	{
+		llvm::Optional<llvm::PGOOptions> pgo;
+		if(shouldGenerateProfile)
+			pgo = llvm::PGOOptions(profileGenerateFile, "", "",
+			                       llvm::PGOOptions::IRInstr);
+		else if(shouldUseProfile && !llvm::sys::fs::exists(profileUseFile))
+		{
+			// Building without the counts would quietly give a different binary.
+			error("Could not open profile '{0}'.", profileUseFile);
+			return false;
+		}
+		else if(shouldUseProfile)
+			pgo = llvm::PGOOptions(profileUseFile, "", "", llvm::PGOOptions::IRUse);
+
+		llvm::LoopAnalysisManager     lam;
+		llvm::FunctionAnalysisManager fam;
+		llvm::CGSCCAnalysisManager    cgam;
+		llvm::ModuleAnalysisManager   mam;
+
+		llvm::PassBuilder pb(machine, llvm::PipelineTuningOptions(), pgo);
+
+		// With real counts, or calls the program marked cold, move the code that
+		// (almost) never runs out of the hot functions.
+		if((pgo && pgo->Action == llvm::PGOOptions::IRUse) || hasColdCode)
+			pb.registerOptimizerLastEPCallback(
+			    [](llvm::ModulePassManager &mpm, llvm::OptimizationLevel) {
+				    mpm.addPass(llvm::HotColdSplittingPass());
+			    });
+
+		pb.registerModuleAnalyses(mam);
+		pb.registerCGSCCAnalyses(cgam);
+		pb.registerFunctionAnalyses(fam);
+		pb.registerLoopAnalyses(lam);
+		pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+		// Which still inlines @always_inline functions, like clang at -O0.
+		if(optimizationLevel <= 0)
+		{
+			pb.buildO0DefaultPipeline(llvm::OptimizationLevel::O0, shouldOutputBitcode)
+			    .run(*codeModule, mam);
+			return true;
+		}
+
+		auto level = llvm::OptimizationLevel::O1;
+		if(optimizationLevel == 2)
+			level = llvm::OptimizationLevel::O2;
+		else if(optimizationLevel >= 3)
+			level = llvm::OptimizationLevel::O3;
+
+		// Bitcode goes to a ThinLTO link, which runs the rest of the pipeline once it
+		// can see the other modules.
+		if(shouldOutputBitcode)
+			pb.buildThinLTOPreLinkDefaultPipeline(level).run(*codeModule, mam);
+		else
+			pb.buildPerModuleDefaultPipeline(level).run(*codeModule, mam);
+		return true;
+	}
+
+	bool GeneratorImpl::output()
 	{
 		// codeModule->print(llvm::errs(), nullptr);
 		llvm::InitializeNativeTarget();
@@ -328,14 +1956,70 @@ namespace noct
 		std::string errorString;
 		auto        target = llvm::TargetRegistry::lookupTarget(triple, errorString);
 
-		auto cpu = "generic";
-		auto fts = "";
+		std::string cpu = targetCPU;
+		std::string fts = "";
+
+		if(cpu == "native")
+		{
+			cpu = llvm::sys::getHostCPUName().str();
+
+			llvm::StringMap<bool>   hostFeatures;
+			llvm::SubtargetFeatures features;
+			if(llvm::sys::getHostCPUFeatures(hostFeatures))
+				for(const auto &f : hostFeatures) features.AddFeature(f.first(), f.second);
+			fts = features.getString();
+		}
+
+		auto level = llvm::CodeGenOpt::None;
+		if(optimizationLevel == 1)
+			level = llvm::CodeGenOpt::Less;
+		else if(optimizationLevel == 2)
+			level = llvm::CodeGenOpt::Default;
+		else if(optimizationLevel >= 3)
+			level = llvm::CodeGenOpt::Aggressive;
+
+		// The built-in linker only does freestanding executables, and the parallel
+		// runtime needs threads from the C++ library.
+		if(shouldOutputExecutable)
+		{
+			for(const auto *name : {"__noct_parallel_for", "__noct_parallel_reduce"})
+				if(codeModule->getFunction(name) != nullptr)
+				{
+					error("Parallel loops cannot be linked into an executable here; "
+					      "build an object file (.o) and link it with libnoct-parallel.a.");
+					return false;
+				}
 
+			// Both call into a runtime library that only a hosted link provides.
+			if(instrumentFunctions || shouldGenerateProfile)
+			{
+				error("Instrumented code cannot be linked into an executable here; "
+				      "build an object file (.o) and link it with the system toolchain.");
+				return false;
+			}
+			freestanding = true;
+		}
+
+		// Freestanding code is linked statically, without a dynamic loader or libc:
+		// no PIC, no GOT, and no calls to library functions LLVM might otherwise
+		// synthesize from loops.
 		llvm::TargetOptions opt;
 		auto                rm = llvm::Optional<llvm::Reloc::Model>();
-		auto machine = target->createTargetMachine(triple, cpu, fts, opt, rm);
+		if(freestanding)
+		{
+			if(!generateStartup(*this, llvm::Triple(triple)))
+				return false;
+
+			rm = llvm::Reloc::Static;
+			for(auto &g : codeModule->global_values()) g.setDSOLocal(true);
+			for(auto &f : *codeModule) f.addFnAttr("no-builtins");
+		}
+		auto machine = target->createTargetMachine(triple, cpu, fts, opt, rm, llvm::None,
+		                                           level);
 
 		codeModule->setDataLayout(machine->createDataLayout());
+		if(!optimize(machine))
+			return false;
 
 		if(shouldOutputObject)
 		{
@@ -345,11 +2029,29 @@ namespace noct
 			                               llvm::sys::fs::FA_Write);
 
 			if(errorCode)
+			{
 				error("Could not open file '{0}'.", outputObjectFile);
+				return false;
+			}
+
+			machine->addPassesToEmitFile(passManager, dest, nullptr,
+			                             llvm::CGFT_ObjectFile);
+			passManager.run(*codeModule);
+		}
+
+		if(shouldOutputExecutable)
+		{
+			llvm::legacy::PassManager passManager;
+			llvm::SmallVector<char, 0> object;
+			llvm::raw_svector_ostream  dest(object);
 
 			machine->addPassesToEmitFile(passManager, dest, nullptr,
 			                             llvm::CGFT_ObjectFile);
 			passManager.run(*codeModule);
+
+			if(!linkExecutable(std::string_view(object.data(), object.size()),
+			                   outputExecutableFile))
+				return false;
 		}
 
 		if(shouldOutputAssembly)
@@ -360,7 +2062,10 @@ namespace noct
 			                               llvm::sys::fs::FA_Write);
 
 			if(errorCode)
+			{
 				error("Could not open file '{0}'.", outputAssemblyFile);
+				return false;
+			}
 
 			machine->addPassesToEmitFile(passManager, dest, nullptr,
 			                             llvm::CGFT_AssemblyFile);
@@ -373,16 +2078,42 @@ namespace noct
 			llvm::raw_fd_ostream dest(outputIRFile, errorCode, llvm::sys::fs::FA_Write);
 
 			if(errorCode)
+			{
 				error("Could not open file '{0}'.", outputIRFile);
+				return false;
+			}
 
 			codeModule->print(dest, nullptr, false, true);
 		}
+
+		if(shouldOutputBitcode)
+		{
+			std::error_code      errorCode;
+			llvm::raw_fd_ostream dest(outputBitcodeFile, errorCode,
+			                          llvm::sys::fs::FA_Write);
+
+			if(errorCode)
+			{
+				error("Could not open file '{0}'.", outputBitcodeFile);
+				return false;
+			}
+
+			// The summary is what lets a ThinLTO link import and inline across modules.
+			// Every call edge in it asks the profile summary how hot the call is.
+			llvm::ProfileSummaryInfo psi(*codeModule);
+			auto index = llvm::buildModuleSummaryIndex(*codeModule, nullptr, &psi);
+			llvm::WriteBitcodeToFile(*codeModule, dest, false, &index, true);
+		}
+
+		return true;
 	}
 
 	void GeneratorImpl::provideImpls(AST *ast)
 	{
 		if(auto n = dynamic_cast<ASTInt *>(ast); n != nullptr)
 			n->impl_ = makePtr<ASTIntImpl>(n);
+		else if(auto n = dynamic_cast<ASTFloat *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTFloatImpl>(n);
 		else if(auto n = dynamic_cast<ASTBlock *>(ast); n != nullptr)
 			n->impl_ = makePtr<ASTBlockImpl>(n);
 		else if(auto n = dynamic_cast<ASTFunc *>(ast); n != nullptr)
@@ -391,6 +2122,24 @@ namespace noct
 			n->impl_ = makePtr<ASTVarImpl>(n);
 		else if(auto n = dynamic_cast<ASTIdn *>(ast); n != nullptr)
 			n->impl_ = makePtr<ASTIdnImpl>(n);
+		else if(auto n = dynamic_cast<ASTCall *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTCallImpl>(n);
+		else if(auto n = dynamic_cast<ASTAssign *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTAssignImpl>(n);
+		else if(auto n = dynamic_cast<ASTIndex *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTIndexImpl>(n);
+		else if(auto n = dynamic_cast<ASTField *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTFieldImpl>(n);
+		else if(auto n = dynamic_cast<ASTIf *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTIfImpl>(n);
+		else if(auto n = dynamic_cast<ASTWhile *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTWhileImpl>(n);
+		else if(auto n = dynamic_cast<ASTParallel *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTParallelImpl>(n);
+		else if(auto n = dynamic_cast<ASTBinary *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTBinaryImpl>(n);
+		else if(auto n = dynamic_cast<ASTUnary *>(ast); n != nullptr)
+			n->impl_ = makePtr<ASTUnaryImpl>(n);
 		else
 			PANIC("Could not provide impl node!");
 
@@ -398,11 +2147,125 @@ namespace noct
 			ast->impl_->provideImpls(*this);
 	}
 
+	auto GeneratorImpl::lookup(const std::string &name) -> Variable *
+	{
+		for(auto e = baseEnv.rbegin(); e != baseEnv.rend(); ++e)
+			if(auto v = e->get(name); v != nullptr)
+				return v;
+		return nullptr;
+	}
+
+	void GeneratorImpl::writeVariable(Local *var, llvm::BasicBlock *block, llvm::Value *value)
+	{
+		currentDef[block][var] = value;
+	}
+
+	auto GeneratorImpl::readVariable(Local *var, llvm::BasicBlock *block) -> llvm::Value *
+	{
+		auto &defs = currentDef[block];
+		if(auto d = defs.find(var); d != defs.end())
+			return d->second;
+		return readVariableRecursive(var, block);
+	}
+
+	auto GeneratorImpl::readVariableRecursive(Local *var, llvm::BasicBlock *block)
+	    -> llvm::Value *
+	{
+		auto createPhi = [&]() {
+			if(auto *first = block->getFirstNonPHI(); first != nullptr)
+				return llvm::PHINode::Create(var->llvmType, 0, "", first);
+			return llvm::PHINode::Create(var->llvmType, 0, "", block);
+		};
+
+		llvm::Value *value;
+		if(!sealedBlocks.count(block))
+		{
+			auto *phi = createPhi();
+			incompletePhis[block].emplace_back(var, phi);
+			value = phi;
+		}
+		else if(auto *pred = block->getSinglePredecessor(); pred != nullptr)
+			value = readVariable(var, pred);
+		else if(llvm::pred_empty(block))
+			value = llvm::UndefValue::get(var->llvmType);
+		else
+		{
+			// Written first, so that a loop back to this block finds the phi.
+			auto *phi = createPhi();
+			writeVariable(var, block, phi);
+			value = addPhiOperands(var, phi);
+		}
+
+		writeVariable(var, block, value);
+		return value;
+	}
+
+	auto GeneratorImpl::addPhiOperands(Local *var, llvm::PHINode *phi) -> llvm::Value *
+	{
+		// Operands are only attached once all are read, so that the reads cannot
+		// find this phi half-built among the users of one they simplify.
+		llvm::SmallVector<std::pair<llvm::WeakTrackingVH, llvm::BasicBlock *>, 4> incoming;
+		for(auto *pred : llvm::predecessors(phi->getParent()))
+			incoming.emplace_back(readVariable(var, pred), pred);
+
+		for(auto &[value, pred] : incoming) phi->addIncoming(value, pred);
+		return tryRemoveTrivialPhi(phi);
+	}
+
+	auto GeneratorImpl::tryRemoveTrivialPhi(llvm::PHINode *phi) -> llvm::Value *
+	{
+		llvm::Value *same = nullptr;
+		for(llvm::Value *op : phi->incoming_values())
+		{
+			if(op == same || op == phi)
+				continue;
+			if(same != nullptr)
+				return phi;
+			same = op;
+		}
+		if(same == nullptr)
+			same = llvm::UndefValue::get(phi->getType());
+
+		// Removing this phi may make the phis that used it trivial in turn.
+		std::vector<llvm::WeakVH> users;
+		for(auto *user : phi->users())
+			if(user != phi && llvm::isa<llvm::PHINode>(user))
+				users.emplace_back(user);
+
+		phi->replaceAllUsesWith(same);
+		for(auto &[block, defs] : currentDef)
+			for(auto &[var, value] : defs)
+				if(value == phi)
+					value = same;
+		phi->eraseFromParent();
+
+		for(auto &user : users)
+			if(auto *p = llvm::dyn_cast_or_null<llvm::PHINode>(user))
+				tryRemoveTrivialPhi(p);
+
+		return same;
+	}
+
+	void GeneratorImpl::sealBlock(llvm::BasicBlock *block)
+	{
+		// Sealed first: completing one phi may read another variable here.
+		sealedBlocks.insert(block);
+		auto phis = std::move(incompletePhis[block]);
+		incompletePhis.erase(block);
+
+		for(auto [var, phi] : phis) addPhiOperands(var, phi);
+	}
+
 	Generator::Generator(const std::string &moduleName)
 	{
 		impl = new GeneratorImpl(moduleName);
 	}
 
+	Generator::Generator(const std::string &moduleName, llvm::LLVMContext &context)
+	{
+		impl = new GeneratorImpl(moduleName, context);
+	}
+
 	Generator::~Generator()
 	{
 		delete impl;
@@ -423,6 +2286,27 @@ namespace noct
 		case GeneratorOpt::ShouldOutputIR:
 			impl->shouldOutputIR = (bool)value;
 			break;
+		case GeneratorOpt::ShouldOutputBitcode:
+			impl->shouldOutputBitcode = (bool)value;
+			break;
+		case GeneratorOpt::ShouldOutputExecutable:
+			impl->shouldOutputExecutable = (bool)value;
+			break;
+		case GeneratorOpt::InstrumentFunctions:
+			impl->instrumentFunctions = (bool)value;
+			break;
+		case GeneratorOpt::BoundsChecks:
+			impl->boundsChecks = (bool)value;
+			break;
+		case GeneratorOpt::Freestanding:
+			impl->freestanding = (bool)value;
+			break;
+		case GeneratorOpt::ShouldGenerateProfile:
+			impl->shouldGenerateProfile = (bool)value;
+			break;
+		case GeneratorOpt::ShouldUseProfile:
+			impl->shouldUseProfile = (bool)value;
+			break;
 		default:
 			assert(0 && "Bad option!");
 		}
@@ -443,6 +2327,33 @@ namespace noct
 		case GeneratorOpt::OutputIRFile:
 			impl->outputIRFile = value;
 			break;
+		case GeneratorOpt::OutputBitcodeFile:
+			impl->outputBitcodeFile = value;
+			break;
+		case GeneratorOpt::OutputExecutableFile:
+			impl->outputExecutableFile = value;
+			break;
+		case GeneratorOpt::TargetCPU:
+			impl->targetCPU = value;
+			break;
+		case GeneratorOpt::ProfileGenerateFile:
+			impl->profileGenerateFile = value;
+			break;
+		case GeneratorOpt::ProfileUseFile:
+			impl->profileUseFile = value;
+			break;
+		default:
+			assert(0 && "Bad option!");
+		}
+	}
+
+	void Generator::set(GeneratorOpt opt, int value) const
+	{
+		switch(opt)
+		{
+		case GeneratorOpt::OptimizationLevel:
+			impl->optimizationLevel = value;
+			break;
 		default:
 			assert(0 && "Bad option!");
 		}
@@ -465,8 +2376,15 @@ namespace noct
 
 #undef TRY_CAST
 	}
-	void Generator::output() const
+	bool Generator::output() const
+	{
+		return impl->output();
+	}
+
+	auto Generator::takeModule() const -> std::unique_ptr<llvm::Module>
 	{
-		impl->output();
+		auto m = std::move(impl->codeModule);
+		impl->codeModule = std::make_unique<llvm::Module>(impl->moduleName, impl->context);
+		return m;
 	}
 } // namespace noct
@@ -2,9 +2,16 @@
 #include "types.hpp"
 #include "ast.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
+namespace llvm
+{
+	class LLVMContext;
+	class Module;
+}
+
 namespace noct
 {
 	enum class GeneratorOpt
@@ -15,6 +22,19 @@ namespace noct
 		OutputObjectFile,
 		ShouldOutputIR,
 		OutputIRFile,
+		ShouldOutputBitcode,
+		OutputBitcodeFile,
+		ShouldOutputExecutable,
+		OutputExecutableFile,
+		OptimizationLevel,
+		TargetCPU,
+		Freestanding,
+		InstrumentFunctions,
+		BoundsChecks,
+		ShouldGenerateProfile,
+		ProfileGenerateFile,
+		ShouldUseProfile,
+		ProfileUseFile,
 	};
 
 	enum class GeneratorBool
@@ -27,11 +47,17 @@ namespace noct
 		struct GeneratorImpl *impl;
 
 		Generator(const std::string &moduleName);
+		Generator(const std::string &moduleName, llvm::LLVMContext &context);
 		~Generator();
 
 		void generateFunction(ASTFunc *func) const;
 		void generate(AST *func) const;
-		void output() const;
+		// False once something has been reported and not every output was written.
+		bool output() const;
+
+		// Hands over everything generated so far and starts an empty module. Symbols
+		// stay known, so later modules can refer to earlier ones (used by the JIT).
+		auto takeModule() const -> std::unique_ptr<llvm::Module>;
 
 		void set(GeneratorOpt opt, GeneratorBool value) const;
 		void set(GeneratorOpt opt, const std::string &value) const;
@@ -0,0 +1,490 @@
+#include "consteval.hpp"
+#include "log.hpp"
+
+#include <bit>
+
+namespace noct
+{
+	namespace
+	{
+		// Bounds on a single evaluation, so a runaway @comptime function makes the
+		// call stay a call instead of hanging the compiler.
+		constexpr std::size_t maxDepth = 256;
+		constexpr std::size_t maxSteps = 1000000;
+
+		// A float is held as the bits of a double, rounded to float for an f32.
+		auto toDouble(ConstValue v) -> double
+		{
+			if(isFloatingNumericType(v.type))
+				return std::bit_cast<double>(v.bits);
+			return isSignedNumericType(v.type) ? double(std::int64_t(v.bits)) : double(v.bits);
+		}
+
+		auto castValue(ConstValue v, NumericType to) -> std::optional<ConstValue>
+		{
+			if(to == NumericType::unknown)
+				return std::nullopt;
+			if(isFloatingNumericType(to))
+			{
+				auto d = toDouble(v);
+				if(to == NumericType::f32)
+					d = float(d);
+				return ConstValue{std::bit_cast<std::uint64_t>(d), to};
+			}
+			// Out of range, a float becomes poison: that is left for run time.
+			if(isFloatingNumericType(v.type))
+				return std::nullopt;
+
+			auto width = getNumericTypeWidth(to) * 8;
+			auto bits = v.bits;
+			if(width < 64)
+			{
+				bits &= (std::uint64_t(1) << width) - 1;
+				if(isSignedNumericType(to) && (bits >> (width - 1)) & 1)
+					bits |= ~std::uint64_t(0) << width;
+			}
+			return ConstValue{bits, to};
+		}
+
+		auto numericOf(const Ptr<Type> &t) -> NumericType
+		{
+			if(auto n = dynamic_cast<TypeNumeric *>(t.get()); n != nullptr)
+				return n->numeric;
+			return NumericType::unknown;
+		}
+
+		// `op` is '+', '-' or '*'. Nothing when the exact result does not fit `type`.
+		auto applyExact(char op, std::uint64_t l, std::uint64_t r, NumericType type)
+		    -> std::optional<std::uint64_t>
+		{
+			std::uint64_t bits;
+			bool          overflow;
+			if(isSignedNumericType(type))
+			{
+				auto sl = std::int64_t(l), sr = std::int64_t(r);
+				std::int64_t v;
+				overflow = op == '+'   ? __builtin_add_overflow(sl, sr, &v)
+				           : op == '-' ? __builtin_sub_overflow(sl, sr, &v)
+				                       : __builtin_mul_overflow(sl, sr, &v);
+				bits = std::uint64_t(v);
+			}
+			else
+				overflow = op == '+'   ? __builtin_add_overflow(l, r, &bits)
+				           : op == '-' ? __builtin_sub_overflow(l, r, &bits)
+				                       : __builtin_mul_overflow(l, r, &bits);
+
+			if(overflow || castValue({bits, type}, type)->bits != bits)
+				return std::nullopt;
+			return bits;
+		}
+
+		// Both operands are already normalized to `type`. Anything LLVM would turn
+		// into poison or a trap is left for run time: overflow of plain arithmetic
+		// is one, of checked arithmetic the other.
+		auto applyBinary(char op, std::uint64_t l, std::uint64_t r, NumericType type)
+		    -> std::optional<std::uint64_t>
+		{
+			bool isSigned = isSignedNumericType(type);
+			auto sl = std::int64_t(l), sr = std::int64_t(r);
+
+			switch(op)
+			{
+			case '+':
+			case TokenType::opr_chadd:
+				return applyExact('+', l, r, type);
+			case '-':
+			case TokenType::opr_chsub:
+				return applyExact('-', l, r, type);
+			case '*':
+			case TokenType::opr_chmul:
+				return applyExact('*', l, r, type);
+			case TokenType::opr_wradd:
+				return l + r;
+			case TokenType::opr_wrsub:
+				return l - r;
+			case TokenType::opr_wrmul:
+				return l * r;
+			case '/':
+				if(r == 0)
+					return std::nullopt;
+				if(isSigned)
+					return sr == -1 ? 0 - l : std::uint64_t(sl / sr);
+				return l / r;
+			case '%':
+				if(r == 0)
+					return std::nullopt;
+				if(isSigned)
+					return sr == -1 ? 0 : std::uint64_t(sl % sr);
+				return l % r;
+			case '&':
+				return l & r;
+			case '|':
+				return l | r;
+			case '^':
+				return l ^ r;
+			case TokenType::opr_shftl:
+				if(r >= getNumericTypeWidth(type) * 8u)
+					return std::nullopt;
+				return l << r;
+			case TokenType::opr_shftr:
+				if(r >= getNumericTypeWidth(type) * 8u)
+					return std::nullopt;
+				return isSigned ? std::uint64_t(sl >> r) : l >> r;
+			case '<':
+				return isSigned ? sl < sr : l < r;
+			case '>':
+				return isSigned ? sl > sr : l > r;
+			case TokenType::opr_lteql:
+				return isSigned ? sl <= sr : l <= r;
+			case TokenType::opr_gteql:
+				return isSigned ? sl >= sr : l >= r;
+			case TokenType::opr_equal:
+				return l == r;
+			case TokenType::opr_noteq:
+				return l != r;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// The same for floats, as `type`, with the comparisons codegen makes: ordered,
+		// but for != which is also true of NaN. The rest is left for run time.
+		auto applyFloat(char op, double l, double r, NumericType type, NumericType result)
+		    -> std::optional<ConstValue>
+		{
+			auto number = [&](double d) { return castValue({std::bit_cast<std::uint64_t>(d),
+			                                                NumericType::f64}, type); };
+			auto truth = [&](bool b) { return castValue({b, result}, result); };
+			switch(op)
+			{
+			case '+':
+				return number(l + r);
+			case '-':
+				return number(l - r);
+			case '*':
+				return number(l * r);
+			case '/':
+				return number(l / r);
+			case '<':
+				return truth(l < r);
+			case '>':
+				return truth(l > r);
+			case TokenType::opr_lteql:
+				return truth(l <= r);
+			case TokenType::opr_gteql:
+				return truth(l >= r);
+			case TokenType::opr_equal:
+				return truth(l == r);
+			case TokenType::opr_noteq:
+				return truth(l != r);
+			default:
+				return std::nullopt;
+			}
+		}
+	} // namespace
+
+	void ConstEvaluator::declare(const Ptr<AST> &node)
+	{
+		if(auto f = std::dynamic_pointer_cast<ASTFunc>(node); f != nullptr)
+			functions[f->decl.name] = f;
+		else if(auto v = std::dynamic_pointer_cast<ASTVar>(node); v != nullptr)
+			globals[v->decl.name] = v;
+	}
+
+	bool ConstEvaluator::fold(Ptr<AST> &node)
+	{
+		steps = 0;
+		failed = false;
+		if(auto v = dynamic_cast<ASTVar *>(node.get()); v != nullptr && v->value)
+		{
+			// A global is initialized from the object file, so it has to be a literal.
+			foldExpr(v->value, true);
+			if(!failed && dynamic_cast<ASTInt *>(v->value.get()) == nullptr
+			   && dynamic_cast<ASTFloat *>(v->value.get()) == nullptr)
+			{
+				error("Cannot initialize global '{0}' with a non-constant!", v->decl.name);
+				return false;
+			}
+		}
+		else if(auto f = dynamic_cast<ASTFunc *>(node.get()); f != nullptr)
+		{
+			// The body itself has to stay a block.
+			if(auto b = dynamic_cast<ASTBlock *>(f->body.get()); b != nullptr)
+				for(auto &n : b->nodes) foldExpr(n, false);
+		}
+		return !failed;
+	}
+
+	auto ConstEvaluator::evaluate(AST *node) -> std::optional<ConstValue>
+	{
+		allowGlobals = true;
+		return eval(node, nullptr);
+	}
+
+	void ConstEvaluator::foldExpr(Ptr<AST> &node, bool initializer)
+	{
+		if(node == nullptr || dynamic_cast<ASTInt *>(node.get()) != nullptr
+		   || dynamic_cast<ASTFloat *>(node.get()) != nullptr)
+			return;
+
+		if(auto b = dynamic_cast<ASTBlock *>(node.get()); b != nullptr)
+			for(auto &n : b->nodes) foldExpr(n, initializer);
+		else if(auto c = dynamic_cast<ASTCall *>(node.get()); c != nullptr)
+			for(auto &a : c->args) foldExpr(a, initializer);
+		else if(auto b = dynamic_cast<ASTBinary *>(node.get()); b != nullptr)
+		{
+			foldExpr(b->lhs, initializer);
+			foldExpr(b->rhs, initializer);
+		}
+		else if(auto u = dynamic_cast<ASTUnary *>(node.get()); u != nullptr)
+			foldExpr(u->operand, initializer);
+		else if(auto i = dynamic_cast<ASTIf *>(node.get()); i != nullptr)
+		{
+			foldExpr(i->cond, initializer);
+			foldExpr(i->then, initializer);
+			foldExpr(i->otherwise, initializer);
+		}
+		else if(auto w = dynamic_cast<ASTWhile *>(node.get()); w != nullptr)
+		{
+			foldExpr(w->cond, initializer);
+			foldExpr(w->body, initializer);
+		}
+		else if(auto p = dynamic_cast<ASTParallel *>(node.get()); p != nullptr)
+		{
+			foldExpr(p->lo, initializer);
+			foldExpr(p->hi, initializer);
+			foldExpr(p->body, initializer);
+		}
+		else if(auto a = dynamic_cast<ASTAssign *>(node.get()); a != nullptr)
+		{
+			foldExpr(a->index, initializer);
+			foldExpr(a->value, initializer);
+		}
+		else if(auto x = dynamic_cast<ASTIndex *>(node.get()); x != nullptr)
+		{
+			foldExpr(x->base, initializer);
+			foldExpr(x->index, initializer);
+		}
+		else if(auto f = dynamic_cast<ASTField *>(node.get()); f != nullptr)
+			foldExpr(f->base, initializer);
+		else if(auto v = dynamic_cast<ASTVar *>(node.get()); v != nullptr)
+			foldExpr(v->value, initializer);
+
+		// Globals can be read in initializers only: at run time they may have changed.
+		allowGlobals = initializer;
+		if(auto v = eval(node.get(), nullptr); v.has_value())
+		{
+			Ptr<AST> literal;
+			if(isFloatingNumericType(v->type))
+				literal = makePtr<ASTFloat>(std::bit_cast<double>(v->bits), v->type);
+			else
+				literal = makePtr<ASTInt>(v->bits, v->type);
+			literal->checkedType = makePtr<TypeNumeric>(v->type);
+			node = literal;
+		}
+	}
+
+	auto ConstEvaluator::eval(AST *node, const Frame *frame) -> std::optional<ConstValue>
+	{
+		if(++steps > maxSteps)
+			return std::nullopt;
+
+		if(auto n = dynamic_cast<ASTInt *>(node); n != nullptr)
+			return castValue({n->value, n->numeric}, n->numeric);
+		if(auto n = dynamic_cast<ASTFloat *>(node); n != nullptr)
+			return castValue({std::bit_cast<std::uint64_t>(n->value), NumericType::f64},
+			                 n->numeric);
+
+		if(auto n = dynamic_cast<ASTIdn *>(node); n != nullptr)
+		{
+			if(frame != nullptr)
+				if(auto i = frame->find(n->name); i != frame->end())
+					return i->second;
+
+			if(allowGlobals)
+				return evalGlobal(n->name);
+			return std::nullopt;
+		}
+
+		if(auto n = dynamic_cast<ASTBlock *>(node); n != nullptr)
+		{
+			// Its lets go into a copy of the enclosing frame, made at the first one.
+			Frame                     locals;
+			const Frame              *scope = frame;
+			std::optional<ConstValue> last;
+			for(const auto &c : n->nodes)
+			{
+				auto v = dynamic_cast<ASTVar *>(c.get());
+				if(v == nullptr)
+				{
+					if(!(last = eval(c.get(), scope)))
+						return std::nullopt;
+					continue;
+				}
+
+				if(scope != &locals && frame != nullptr)
+					locals = *frame;
+				scope = &locals;
+
+				auto type = numericOf(v->decl.type);
+				auto value = v->value != nullptr ? eval(v->value.get(), scope)
+				                                 : ConstValue{0, type};
+				if(!value || !(value = castValue(*value, type)))
+					return std::nullopt;
+				locals[v->decl.name] = *value;
+				last = std::nullopt; // a block ending in a let has no value
+			}
+			return last;
+		}
+
+		if(auto n = dynamic_cast<ASTCall *>(node); n != nullptr)
+		{
+			// The length of an array is part of its type.
+			if(n->builtin == Builtin::len)
+				if(auto a = dynamic_cast<TypeArray *>(n->args[0]->checkedType.get()))
+					return ConstValue{a->count, NumericType::u64};
+			return evalCall(n, frame);
+		}
+
+		if(auto n = dynamic_cast<ASTBinary *>(node); n != nullptr)
+		{
+			auto l = eval(n->lhs.get(), frame);
+			if(!l)
+				return std::nullopt;
+
+			auto result = numericOf(n->checkedType);
+			if((n->op == TokenType::opr_d_amp || n->op == TokenType::opr_d_bar)
+			   && isFloatingNumericType(l->type))
+				return std::nullopt;
+			if(n->op == TokenType::opr_d_amp || n->op == TokenType::opr_d_bar)
+			{
+				// Short-circuited like at run time: the right side may not be constant.
+				if((l->bits != 0) == (n->op == TokenType::opr_d_bar))
+					return castValue({l->bits != 0, result}, result);
+				auto r = eval(n->rhs.get(), frame);
+				if(!r || isFloatingNumericType(r->type))
+					return std::nullopt;
+				return castValue({r->bits != 0, result}, result);
+			}
+
+			auto r = eval(n->rhs.get(), frame);
+			auto type = numericOf(n->operandType);
+			if(!r || !(l = castValue(*l, type)) || !(r = castValue(*r, type)))
+				return std::nullopt;
+			if(isFloatingNumericType(type))
+				return applyFloat(n->op, toDouble(*l), toDouble(*r), type, result);
+
+			// Poison at run time, so it is an error wherever it is found.
+			auto width = getNumericTypeWidth(type) * 8u;
+			if((n->op == TokenType::opr_shftl || n->op == TokenType::opr_shftr)
+			   && r->bits >= width)
+			{
+				if(reported.insert(n).second)
+					error("Cannot shift a {0}-bit value by {1}.", width,
+					      isSignedNumericType(type) ? std::to_string(std::int64_t(r->bits))
+					                                : std::to_string(r->bits));
+				failed = true;
+				return std::nullopt;
+			}
+
+			auto bits = applyBinary(n->op, l->bits, r->bits, type);
+			if(!bits)
+				return std::nullopt;
+			return castValue({*bits, result}, result);
+		}
+
+		if(auto n = dynamic_cast<ASTUnary *>(node); n != nullptr)
+		{
+			auto v = eval(n->operand.get(), frame);
+			auto result = numericOf(n->checkedType);
+			if(!v)
+				return std::nullopt;
+			if(isFloatingNumericType(v->type))
+				return n->op == '-' ? castValue({std::bit_cast<std::uint64_t>(-toDouble(*v)),
+				                                 NumericType::f64}, result)
+				                    : std::nullopt;
+			if(n->op == '-')
+				return castValue({0 - v->bits, result}, result);
+			if(n->op == '~')
+				return castValue({~v->bits, result}, result);
+			if(n->op == '!')
+				return castValue({v->bits == 0, result}, result);
+			return std::nullopt;
+		}
+
+		if(auto n = dynamic_cast<ASTIf *>(node); n != nullptr)
+		{
+			auto c = eval(n->cond.get(), frame);
+			if(!c || isFloatingNumericType(c->type))
+				return std::nullopt;
+
+			auto *branch = c->bits != 0 ? n->then.get() : n->otherwise.get();
+			auto  v = branch != nullptr ? eval(branch, frame) : std::nullopt;
+			if(!v)
+				return std::nullopt;
+			return castValue(*v, numericOf(n->checkedType));
+		}
+
+		return std::nullopt;
+	}
+
+	auto ConstEvaluator::evalGlobal(const std::string &name) -> std::optional<ConstValue>
+	{
+		// Once code has run, a global that can be written holds whatever it was last
+		// given, and only whoever ran the code knows it.
+		auto g = globals.find(name);
+		if(readGlobal && g != globals.end() && !g->second->decl.constant)
+		{
+			auto v = readGlobal(*g->second);
+			return v ? castValue(*v, numericOf(g->second->decl.type)) : std::nullopt;
+		}
+
+		if(auto i = globalValues.find(name); i != globalValues.end())
+			return i->second;
+
+		if(g == globals.end() || g->second->value == nullptr || evaluating.count(name))
+			return std::nullopt;
+
+		evaluating.insert(name);
+		auto v = eval(g->second->value.get(), nullptr);
+		evaluating.erase(name);
+
+		if(v)
+			v = castValue(*v, numericOf(g->second->decl.type));
+		if(v)
+			globalValues[name] = *v;
+		return v;
+	}
+
+	auto ConstEvaluator::evalCall(ASTCall *call, const Frame *frame)
+	    -> std::optional<ConstValue>
+	{
+		auto f = functions.find(call->name);
+		if(f == functions.end() || !f->second->decl.hasAttribute("comptime")
+		   || depth >= maxDepth)
+			return std::nullopt;
+
+		const auto &decl = f->second->decl;
+		if(call->args.size() != decl.argNames.size())
+			return std::nullopt;
+
+		Frame callee;
+		for(std::size_t i = 0; i < call->args.size(); ++i)
+		{
+			auto a = eval(call->args[i].get(), frame);
+			if(a)
+				a = castValue(*a, numericOf(decl.signature.argTypes[i]));
+			if(!a)
+				return std::nullopt;
+			callee[decl.argNames[i]] = *a;
+		}
+
+		++depth;
+		auto v = eval(f->second->body.get(), &callee);
+		--depth;
+
+		if(!v)
+			return std::nullopt;
+		return castValue(*v, numericOf(decl.signature.returnType));
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "util.hpp"
+#include "ast.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace noct
+{
+	struct ConstValue
+	{
+		std::uint64_t bits; // two's complement, normalized to the width of `type`;
+		                    // a float as the bits of a double
+		NumericType   type;
+	};
+
+	// Evaluates constant expressions over the typechecked AST and folds them into
+	// literals: global initializers, and calls to @comptime functions whose
+	// arguments are all constant. A @comptime function stays an ordinary function
+	// for the calls that cannot be evaluated.
+	class ConstEvaluator
+	{
+	public:
+		void declare(const Ptr<AST> &node);
+		// False, once reported, for a global whose initializer is not constant, and
+		// for a constant shift by the width of its operand or more.
+		bool fold(Ptr<AST> &node);
+
+		auto evaluate(AST *node) -> std::optional<ConstValue>;
+
+		// Before anything runs, a global holds what it is initialized with. Where code
+		// may have run since (the REPL), this reads what a global that is not
+		// constant holds now; a float comes as the bits of a double.
+		std::function<std::optional<ConstValue>(const ASTVar &)> readGlobal;
+
+	private:
+		using Frame = std::unordered_map<std::string, ConstValue>;
+
+		auto eval(AST *node, const Frame *frame) -> std::optional<ConstValue>;
+		auto evalGlobal(const std::string &name) -> std::optional<ConstValue>;
+		auto evalCall(ASTCall *call, const Frame *frame) -> std::optional<ConstValue>;
+		void foldExpr(Ptr<AST> &node, bool initializer);
+
+		// Shared, since a REPL session drops each item once it has been generated.
+		std::unordered_map<std::string, Ptr<ASTFunc>> functions;
+		std::unordered_map<std::string, Ptr<ASTVar>>  globals;
+		std::unordered_map<std::string, ConstValue>   globalValues;
+		std::unordered_set<std::string>               evaluating;
+		std::unordered_set<const AST *>               reported; // so each error is printed once
+		bool                                          failed = false;
+
+		bool        allowGlobals = false;
+		std::size_t depth = 0;
+		std::size_t steps = 0;
+	};
+}
@@ -0,0 +1,145 @@
+#include "generic.hpp"
+
+#include <sstream>
+
+namespace noct
+{
+	namespace
+	{
+		// A fresh tree, without anything the typechecker or the code generator
+		// attached to the original.
+		auto cloneNode(const AST *node, const TypeBindings &bindings, bool &ok) -> Ptr<AST>
+		{
+			auto clone = [&](const Ptr<AST> &n) {
+				return n != nullptr ? cloneNode(n.get(), bindings, ok) : nullptr;
+			};
+
+			if(auto n = dynamic_cast<const ASTIdn *>(node); n != nullptr)
+				return makePtr<ASTIdn>(n->name);
+			if(auto n = dynamic_cast<const ASTInt *>(node); n != nullptr)
+				return makePtr<ASTInt>(n->value, n->numeric, n->suffixed);
+			if(auto n = dynamic_cast<const ASTFloat *>(node); n != nullptr)
+				return makePtr<ASTFloat>(n->value, n->numeric, n->suffixed);
+			if(auto n = dynamic_cast<const ASTVar *>(node); n != nullptr)
+			{
+				auto v = makePtr<ASTVar>();
+				v->decl = n->decl;
+				v->decl.type = substituteTypeParameters(n->decl.type, bindings);
+				ok = ok && v->decl.type != nullptr;
+				v->value = clone(n->value);
+				return v;
+			}
+			if(auto n = dynamic_cast<const ASTBlock *>(node); n != nullptr)
+			{
+				auto b = makePtr<ASTBlock>();
+				b->attributes = n->attributes;
+				for(const auto &c : n->nodes) b->nodes.push_back(clone(c));
+				return b;
+			}
+			if(auto n = dynamic_cast<const ASTCall *>(node); n != nullptr)
+			{
+				auto c = makePtr<ASTCall>(n->generic.empty() ? n->name : n->generic);
+				for(const auto &a : n->args) c->args.push_back(clone(a));
+				return c;
+			}
+			if(auto n = dynamic_cast<const ASTAssign *>(node); n != nullptr)
+			{
+				auto a = makePtr<ASTAssign>(n->name);
+				a->index = clone(n->index);
+				a->field = n->field;
+				a->value = clone(n->value);
+				return a;
+			}
+			if(auto n = dynamic_cast<const ASTIndex *>(node); n != nullptr)
+				return makePtr<ASTIndex>(clone(n->base), clone(n->index));
+			if(auto n = dynamic_cast<const ASTField *>(node); n != nullptr)
+				return makePtr<ASTField>(clone(n->base), n->field);
+			if(auto n = dynamic_cast<const ASTIf *>(node); n != nullptr)
+			{
+				auto i = makePtr<ASTIf>();
+				i->cond = clone(n->cond);
+				i->then = clone(n->then);
+				i->otherwise = clone(n->otherwise);
+				return i;
+			}
+			if(auto n = dynamic_cast<const ASTWhile *>(node); n != nullptr)
+			{
+				auto w = makePtr<ASTWhile>();
+				w->cond = clone(n->cond);
+				w->body = clone(n->body);
+				return w;
+			}
+			if(auto n = dynamic_cast<const ASTParallel *>(node); n != nullptr)
+			{
+				auto p = makePtr<ASTParallel>();
+				p->var = n->var;
+				p->lo = clone(n->lo);
+				p->hi = clone(n->hi);
+				p->body = clone(n->body);
+				p->op = n->op;
+				return p;
+			}
+			if(auto n = dynamic_cast<const ASTBinary *>(node); n != nullptr)
+				return makePtr<ASTBinary>(n->op, clone(n->lhs), clone(n->rhs));
+			if(auto n = dynamic_cast<const ASTUnary *>(node); n != nullptr)
+				return makePtr<ASTUnary>(n->op, clone(n->operand));
+
+			ok = false;
+			return nullptr;
+		}
+	} // namespace
+
+	auto getInstanceName(const FuncDeclaration &decl, const TypeBindings &bindings)
+	    -> std::string
+	{
+		// Built for every generic call, to find the instance by: a stream is only
+		// set up for the rare type that is not a plain number.
+		auto name = decl.name + "<";
+		for(std::size_t i = 0; i < decl.typeParams.size(); ++i)
+		{
+			const auto &t = bindings.at(decl.typeParams[i]->name);
+			name += i == 0 ? "" : ",";
+			if(auto n = dynamic_cast<TypeNumeric *>(t.get()); n != nullptr)
+				name += getNumericTypeName(n->numeric);
+			else
+			{
+				std::ostringstream out;
+				t->print(out);
+				name += out.str();
+			}
+		}
+		return name + ">";
+	}
+
+	auto instantiateFunction(const ASTFunc &generic, const TypeBindings &bindings)
+	    -> Ptr<ASTFunc>
+	{
+		auto f = makePtr<ASTFunc>();
+		f->decl = generic.decl;
+		f->decl.name = getInstanceName(generic.decl, bindings);
+		f->decl.typeParams.clear();
+		f->decl.exported = false;
+
+		bool ok = true;
+		auto substitute = [&](Ptr<Type> &t) {
+			t = substituteTypeParameters(t, bindings);
+			ok = ok && t != nullptr;
+		};
+		substitute(f->decl.signature.returnType);
+		for(auto &t : f->decl.signature.argTypes) substitute(t);
+
+		f->body = cloneNode(generic.body.get(), bindings, ok);
+		return ok ? f : nullptr;
+	}
+
+	void monomorphize(std::vector<Ptr<AST>> &program, TypecheckEnv &env)
+	{
+		std::erase_if(program, [](const Ptr<AST> &n) {
+			auto f = dynamic_cast<ASTFunc *>(n.get());
+			return f != nullptr && !f->decl.typeParams.empty();
+		});
+
+		auto instances = env.takeInstances();
+		program.insert(program.end(), instances.begin(), instances.end());
+	}
+}
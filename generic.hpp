@@ -0,0 +1,21 @@
+#pragma once
+#include "util.hpp"
+#include "ast.hpp"
+
+#include <string>
+#include <vector>
+
+namespace noct
+{
+	// What the instance of a generic function for `bindings` is called: `max<i32>`.
+	auto getInstanceName(const FuncDeclaration &decl, const TypeBindings &bindings)
+	    -> std::string;
+
+	// A copy of a generic function with its type parameters replaced, still to be
+	// typechecked. Null if a type in it cannot be substituted.
+	auto instantiateFunction(const ASTFunc &generic, const TypeBindings &bindings)
+	    -> Ptr<ASTFunc>;
+
+	// Swaps the generic functions of a typechecked program for their instances.
+	void monomorphize(std::vector<Ptr<AST>> &program, TypecheckEnv &env);
+}
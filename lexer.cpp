@@ -1,5 +1,6 @@
 #include "lexer.hpp"
 #include <cctype>
+#include <cstring>
 
 namespace noct
 {
@@ -23,6 +24,16 @@ namespace noct
 					current.type = TokenType::opr_decnt;
 					current.value += lexer.in.get();
 				}
+				else if(lexer.in.peek() == '%')
+				{
+					current.type = TokenType::opr_wrsub;
+					current.value += lexer.in.get();
+				}
+				else if(lexer.in.peek() == '?')
+				{
+					current.type = TokenType::opr_chsub;
+					current.value += lexer.in.get();
+				}
 				break;
 			case '=':
 				current.type = lexer.in.get();
@@ -33,6 +44,7 @@ namespace noct
 				}
 				break;
 			case '!':
+				lexer.in.get();
 				if(lexer.in.peek() == '=')
 				{
 					current.type = TokenType::opr_noteq;
@@ -40,13 +52,38 @@ namespace noct
 				}
 				break;
 			case '+':
+				lexer.in.get();
 				if(lexer.in.peek() == '+')
 				{
 					current.type = TokenType::opr_incnt;
 					current.value += lexer.in.get();
 				}
+				else if(lexer.in.peek() == '%')
+				{
+					current.type = TokenType::opr_wradd;
+					current.value += lexer.in.get();
+				}
+				else if(lexer.in.peek() == '?')
+				{
+					current.type = TokenType::opr_chadd;
+					current.value += lexer.in.get();
+				}
+				break;
+			case '*':
+				lexer.in.get();
+				if(lexer.in.peek() == '%')
+				{
+					current.type = TokenType::opr_wrmul;
+					current.value += lexer.in.get();
+				}
+				else if(lexer.in.peek() == '?')
+				{
+					current.type = TokenType::opr_chmul;
+					current.value += lexer.in.get();
+				}
 				break;
 			case '&':
+				lexer.in.get();
 				if(lexer.in.peek() == '&')
 				{
 					current.type = TokenType::opr_d_amp;
@@ -54,6 +91,7 @@ namespace noct
 				}
 				break;
 			case '|':
+				lexer.in.get();
 				if(lexer.in.peek() == '|')
 				{
 					current.type = TokenType::opr_d_bar;
@@ -61,6 +99,7 @@ namespace noct
 				}
 				break;
 			case '>':
+				lexer.in.get();
 				if(lexer.in.peek() == '=')
 				{
 					current.type = TokenType::opr_gteql;
@@ -73,9 +112,10 @@ namespace noct
 				}
 				break;
 			case '<':
+				lexer.in.get();
 				if(lexer.in.peek() == '=')
 				{
-					current.type = TokenType::opr_gteql;
+					current.type = TokenType::opr_lteql;
 					current.value += lexer.in.get();
 				}
 				else if(lexer.in.peek() == '<')
@@ -84,6 +124,14 @@ namespace noct
 					current.value += lexer.in.get();
 				}
 				break;
+			case '.':
+				lexer.in.get();
+				if(lexer.in.peek() == '.')
+				{
+					current.type = TokenType::opr_range;
+					current.value += lexer.in.get();
+				}
+				break;
 			default:
 				// current.value = std::string(1, lexer.in.peek());
 				current.type = lexer.in.get();
@@ -112,6 +160,18 @@ namespace noct
 				current.type = TokenType::kwd_let;
 			else if(current.value == "else")
 				current.type = TokenType::kwd_else;
+			else if(current.value == "pub")
+				current.type = TokenType::kwd_pub;
+			else if(current.value == "while")
+				current.type = TokenType::kwd_while;
+			else if(current.value == "restrict")
+				current.type = TokenType::kwd_restrict;
+			else if(current.value == "readonly")
+				current.type = TokenType::kwd_readonly;
+			else if(current.value == "struct")
+				current.type = TokenType::kwd_struct;
+			else if(current.value == "parallel")
+				current.type = TokenType::kwd_parallel;
 			else
 				current.type = TokenType::idn;
 		}
@@ -119,8 +179,32 @@ namespace noct
 		{
 			current.type = TokenType::num;
 			current.value = "";
-			while(std::isdigit(lexer.in.peek()) || lexer.in.peek() == '_')
-				current.value += lexer.in.get();
+			// Radix prefixes and type suffixes are part of the token; the parser
+			// takes it apart. So are a fraction and the sign of an exponent.
+			auto &v = current.value;
+			auto decimal = [&] {
+				return !(v.size() > 1 && v[0] == '0' && std::strchr("xXbB", v[1]) != nullptr);
+			};
+			for(;;)
+			{
+				int c = lexer.in.peek();
+				if(std::isalnum(c) || c == '_')
+					v += lexer.in.get();
+				else if((c == '+' || c == '-') && decimal() && (v.back() == 'e' || v.back() == 'E'))
+					v += lexer.in.get();
+				else if(c == '.' && decimal())
+				{
+					lexer.in.get();
+					if(!std::isdigit(lexer.in.peek()))
+					{
+						lexer.in.putback('.');
+						break;
+					}
+					v += '.';
+				}
+				else
+					break;
+			}
 		}
 		else if(lexer.in.peek() == EOF)
 		{
@@ -155,4 +239,11 @@ opr_lteql, // <=
 opr_gteql, // >=
 opr_shftr, // >>
 opr_shftl, // <<
+opr_wradd, // +%
+opr_wrsub, // -%
+opr_wrmul, // *%
+opr_chadd, // +?
+opr_chsub, // -?
+opr_chmul, // *?
+opr_range, // ..
 */
@@ -0,0 +1,308 @@
+#include "linker.hpp"
+#include "log.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/BinaryFormat/ELF.h>
+#include <llvm/Object/ELFObjectFile.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MathExtras.h>
+
+namespace noct
+{
+	namespace
+	{
+		constexpr std::uint64_t baseAddress = 0x400000;
+		constexpr std::uint64_t pageSize = 0x1000;
+
+		enum SegmentKind
+		{
+			ReadOnly,
+			Executable,
+			Writable,
+			SegmentCount
+		};
+
+		struct Segment
+		{
+			std::vector<char> bytes;
+			std::uint64_t     memSize = 0;
+			std::uint64_t     offset = 0;
+			std::uint64_t     flags = 0;
+
+			auto address() const -> std::uint64_t
+			{
+				return baseAddress + offset;
+			}
+		};
+
+		struct Placement
+		{
+			SegmentKind   segment;
+			std::uint64_t offset; // within the segment
+		};
+
+		constexpr std::size_t headersSize = sizeof(llvm::ELF::Elf64_Ehdr)
+		                                  + sizeof(llvm::ELF::Elf64_Phdr) * (SegmentCount + 1);
+
+		template<typename T>
+		void write(std::vector<char> &bytes, std::uint64_t offset, T value)
+		{
+			std::memcpy(bytes.data() + offset, &value, sizeof(T));
+		}
+
+		template<typename T>
+		void append(std::vector<char> &bytes, const T &value)
+		{
+			auto p = reinterpret_cast<const char *>(&value);
+			bytes.insert(bytes.end(), p, p + sizeof(T));
+		}
+	} // namespace
+
+	bool linkExecutable(std::string_view object, const std::string &output)
+	{
+		auto buffer = llvm::MemoryBufferRef(llvm::StringRef(object.data(), object.size()),
+		                                    output);
+		auto parsed = llvm::object::ObjectFile::createELFObjectFile(buffer);
+		if(!parsed)
+		{
+			error("Could not read the generated object: {0}",
+			      llvm::toString(parsed.takeError()));
+			return false;
+		}
+
+		auto *elf = llvm::dyn_cast<llvm::object::ELF64LEObjectFile>(parsed->get());
+		if(elf == nullptr || elf->getArch() != llvm::Triple::x86_64)
+		{
+			error("The built-in linker only supports x86-64 ELF.");
+			return false;
+		}
+
+		Segment segments[SegmentCount];
+		segments[ReadOnly].flags = llvm::ELF::PF_R;
+		segments[Executable].flags = llvm::ELF::PF_R | llvm::ELF::PF_X;
+		segments[Writable].flags = llvm::ELF::PF_R | llvm::ELF::PF_W;
+
+		segments[ReadOnly].bytes.resize(headersSize);
+
+		// Lay out the allocated sections, zero-filled ones last so that they can
+		// live past the end of the file.
+		std::unordered_map<std::uint64_t, Placement> placements;
+		for(int pass = 0; pass < 2; ++pass)
+			for(const auto &section : elf->sections())
+			{
+				llvm::object::ELFSectionRef s(section);
+				bool nobits = s.getType() == llvm::ELF::SHT_NOBITS;
+				if(!(s.getFlags() & llvm::ELF::SHF_ALLOC) || nobits != (pass == 1))
+					continue;
+
+				auto kind = ReadOnly;
+				if(s.getFlags() & llvm::ELF::SHF_EXECINSTR)
+					kind = Executable;
+				else if(s.getFlags() & llvm::ELF::SHF_WRITE)
+					kind = Writable;
+
+				auto &segment = segments[kind];
+				auto  align = std::max<std::uint64_t>(section.getAlignment(), 1);
+				auto  offset = llvm::alignTo(std::max<std::uint64_t>(
+				                                 segment.bytes.size(), segment.memSize),
+				                             align);
+				placements[section.getIndex()] = {kind, offset};
+
+				if(nobits)
+				{
+					segment.memSize = offset + section.getSize();
+					continue;
+				}
+
+				auto contents = section.getContents();
+				if(!contents)
+				{
+					error("Could not read a section: {0}",
+					      llvm::toString(contents.takeError()));
+					return false;
+				}
+
+				segment.bytes.resize(offset);
+				segment.bytes.insert(segment.bytes.end(), contents->begin(),
+				                     contents->end());
+			}
+
+		std::uint64_t offset = 0;
+		for(auto &segment : segments)
+		{
+			segment.memSize = std::max<std::uint64_t>(segment.memSize,
+			                                          segment.bytes.size());
+			segment.offset = offset;
+			offset = llvm::alignTo(offset + segment.bytes.size(), pageSize);
+		}
+
+		auto addressOf = [&](const llvm::object::SymbolRef &symbol,
+		                     std::uint64_t &address) -> bool
+		{
+			auto name = symbol.getName();
+			auto section = symbol.getSection();
+			auto value = symbol.getValue();
+			if(!name || !section || !value)
+			{
+				llvm::consumeError(name.takeError());
+				llvm::consumeError(section.takeError());
+				llvm::consumeError(value.takeError());
+				error("Could not read a symbol.");
+				return false;
+			}
+
+			auto p = *section != elf->section_end()
+			           ? placements.find((*section)->getIndex())
+			           : placements.end();
+			if(p == placements.end())
+			{
+				error("Undefined symbol '{0}'.", name->str());
+				return false;
+			}
+
+			address = segments[p->second.segment].address() + p->second.offset + *value;
+			return true;
+		};
+
+		for(const auto &section : elf->sections())
+		{
+			auto target = section.getRelocatedSection();
+			if(!target)
+			{
+				llvm::consumeError(target.takeError());
+				continue;
+			}
+
+			auto placement = *target != elf->section_end()
+			                   ? placements.find((*target)->getIndex())
+			                   : placements.end();
+			if(placement == placements.end())
+				continue;
+
+			auto &segment = segments[placement->second.segment];
+
+			for(const auto &reloc : section.relocations())
+			{
+				llvm::object::ELFRelocationRef r(reloc);
+
+				std::uint64_t s = 0;
+				if(r.getSymbol() != elf->symbol_end() && !addressOf(*r.getSymbol(), s))
+					return false;
+
+				auto addend = r.getAddend();
+				if(!addend)
+				{
+					llvm::consumeError(addend.takeError());
+					error("Relocations without addends are not supported.");
+					return false;
+				}
+
+				auto          where = placement->second.offset + r.getOffset();
+				std::uint64_t p = segment.address() + where;
+				std::int64_t  a = *addend;
+
+				switch(r.getType())
+				{
+				case llvm::ELF::R_X86_64_NONE:
+					break;
+				case llvm::ELF::R_X86_64_64:
+					write<std::uint64_t>(segment.bytes, where, s + a);
+					break;
+				case llvm::ELF::R_X86_64_PC32:
+				case llvm::ELF::R_X86_64_PLT32:
+					write<std::int32_t>(segment.bytes, where, s + a - p);
+					break;
+				case llvm::ELF::R_X86_64_PC64:
+					write<std::int64_t>(segment.bytes, where, s + a - p);
+					break;
+				case llvm::ELF::R_X86_64_32:
+				case llvm::ELF::R_X86_64_32S:
+					write<std::int32_t>(segment.bytes, where, s + a);
+					break;
+				default:
+					error("Unsupported relocation type {0}.", r.getType());
+					return false;
+				}
+			}
+		}
+
+		std::uint64_t entry = 0;
+		bool          found = false;
+		for(const auto &symbol : elf->symbols())
+		{
+			auto name = symbol.getName();
+			if(name && *name == "_start")
+				found = addressOf(symbol, entry);
+			else if(!name)
+				llvm::consumeError(name.takeError());
+		}
+
+		if(!found)
+		{
+			error("No '_start' entry point, the object was not built freestanding.");
+			return false;
+		}
+
+		std::vector<char> headers;
+
+		llvm::ELF::Elf64_Ehdr ehdr{};
+		std::memcpy(ehdr.e_ident, llvm::ELF::ElfMagic, 4);
+		ehdr.e_ident[llvm::ELF::EI_CLASS] = llvm::ELF::ELFCLASS64;
+		ehdr.e_ident[llvm::ELF::EI_DATA] = llvm::ELF::ELFDATA2LSB;
+		ehdr.e_ident[llvm::ELF::EI_VERSION] = llvm::ELF::EV_CURRENT;
+		ehdr.e_ident[llvm::ELF::EI_OSABI] = llvm::ELF::ELFOSABI_NONE;
+		ehdr.e_type = llvm::ELF::ET_EXEC;
+		ehdr.e_machine = llvm::ELF::EM_X86_64;
+		ehdr.e_version = llvm::ELF::EV_CURRENT;
+		ehdr.e_entry = entry;
+		ehdr.e_phoff = sizeof(ehdr);
+		ehdr.e_ehsize = sizeof(ehdr);
+		ehdr.e_phentsize = sizeof(llvm::ELF::Elf64_Phdr);
+		ehdr.e_phnum = SegmentCount + 1;
+		append(headers, ehdr);
+
+		for(const auto &segment : segments)
+		{
+			llvm::ELF::Elf64_Phdr phdr{};
+			phdr.p_type = llvm::ELF::PT_LOAD;
+			phdr.p_flags = segment.flags;
+			phdr.p_offset = segment.offset;
+			phdr.p_vaddr = phdr.p_paddr = segment.address();
+			phdr.p_filesz = segment.bytes.size();
+			phdr.p_memsz = segment.memSize;
+			phdr.p_align = pageSize;
+			append(headers, phdr);
+		}
+
+		llvm::ELF::Elf64_Phdr stack{};
+		stack.p_type = llvm::ELF::PT_GNU_STACK;
+		stack.p_flags = llvm::ELF::PF_R | llvm::ELF::PF_W;
+		append(headers, stack);
+
+		std::memcpy(segments[ReadOnly].bytes.data(), headers.data(), headers.size());
+
+		std::ofstream out(output, std::ios::binary | std::ios::trunc);
+		if(!out)
+		{
+			error("Could not open file '{0}'.", output);
+			return false;
+		}
+
+		for(const auto &segment : segments)
+		{
+			out.seekp(segment.offset);
+			out.write(segment.bytes.data(), segment.bytes.size());
+		}
+		out.close();
+
+		llvm::sys::fs::setPermissions(output, llvm::sys::fs::all_read
+		                                      | llvm::sys::fs::all_exe
+		                                      | llvm::sys::fs::owner_write);
+		return true;
+	}
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace noct
+{
+	// Links one relocatable x86-64 ELF object into a static executable entered at its
+	// _start, as emitted for the freestanding target. There is no libc and no dynamic
+	// loader: every symbol the object references has to be defined in it.
+	bool linkExecutable(std::string_view object, const std::string &output);
+}
@@ -0,0 +1,202 @@
+#include "literal.hpp"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace noct
+{
+	namespace
+	{
+		constexpr std::uint8_t notADigit = 0xFF;
+
+		constexpr auto makeDigitTable() -> std::array<std::uint8_t, 256>
+		{
+			std::array<std::uint8_t, 256> table{};
+			for(auto &d : table) d = notADigit;
+			for(int c = '0'; c <= '9'; ++c) table[c] = c - '0';
+			for(int c = 'a'; c <= 'f'; ++c) table[c] = c - 'a' + 10;
+			for(int c = 'A'; c <= 'F'; ++c) table[c] = c - 'A' + 10;
+			return table;
+		}
+
+		constexpr auto digitTable = makeDigitTable();
+
+		// Eight ASCII digits at once (Lemire, "Fast conversion of 8 digits"). The
+		// first digit is in the lowest byte, which is how a little-endian load
+		// leaves them.
+		constexpr auto isEightDigits(std::uint64_t c) -> bool
+		{
+			return ((c & 0xF0F0F0F0F0F0F0F0)
+			        | (((c + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+			    == 0x3333333333333333;
+		}
+
+		constexpr auto convertEightDigits(std::uint64_t c) -> std::uint32_t
+		{
+			c -= 0x3030303030303030;
+			c = (c * 10) + (c >> 8);
+			c = (((c & 0x000000FF000000FF) * 0x000F424000000064)
+			     + (((c >> 16) & 0x000000FF000000FF) * 0x0000271000000001))
+			    >> 32;
+			return std::uint32_t(c);
+		}
+
+		auto loadEight(const char *p) -> std::uint64_t
+		{
+			std::uint64_t c;
+			std::memcpy(&c, p, sizeof c);
+			if constexpr(std::endian::native == std::endian::big)
+				c = __builtin_bswap64(c);
+			return c;
+		}
+
+		auto accumulate(std::uint64_t &value, std::uint64_t radix, std::uint64_t digit)
+		    -> bool
+		{
+			return !__builtin_mul_overflow(value, radix, &value)
+			    && !__builtin_add_overflow(value, digit, &value);
+		}
+
+		// `digits` holds nothing but digits of `radix` by now.
+		auto convertDigits(std::string_view digits, unsigned radix, std::uint64_t &value)
+		    -> bool
+		{
+			value = 0;
+			std::size_t i = 0;
+
+			// 10^8 fits 27 bits, so the first two chunks (16 digits) cannot overflow;
+			// past that the tail below checks every step.
+			if(radix == 10)
+				for(; i + 8 <= digits.size() && i < 16; i += 8)
+				{
+					auto c = loadEight(digits.data() + i);
+					if(!isEightDigits(c))
+						break;
+					value = value * 100000000 + convertEightDigits(c);
+				}
+
+			for(; i < digits.size(); ++i)
+				if(!accumulate(value, radix, digitTable[std::uint8_t(digits[i])]))
+					return false;
+			return true;
+		}
+
+		auto parseSuffix(std::string_view s) -> NumericType
+		{
+			constexpr std::pair<std::string_view, NumericType> suffixes[] = {
+				{ "i8", NumericType::i8 }, { "i16", NumericType::i16 },
+				{ "i32", NumericType::i32 }, { "i64", NumericType::i64 },
+				{ "u8", NumericType::u8 }, { "u16", NumericType::u16 },
+				{ "u32", NumericType::u32 }, { "u64", NumericType::u64 },
+			};
+			for(const auto &[name, type] : suffixes)
+				if(s == name)
+					return type;
+			return NumericType::unknown;
+		}
+	} // namespace
+
+	auto parseIntegerLiteral(std::string_view text) -> IntegerLiteral
+	{
+		IntegerLiteral result;
+
+		unsigned radix = 10;
+		if(text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+			radix = 16, text.remove_prefix(2);
+		else if(text.size() > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B'))
+			radix = 2, text.remove_prefix(2);
+
+		// Digits (and separators) up to the suffix, which starts with `i` or `u`.
+		// Neither is a hex digit, so the split is the same for every radix.
+		// Leading zeros are dropped, so whatever is left past 64 digits overflows.
+		char digits[64];
+		std::size_t count = 0, i = 0;
+		bool any = false;
+		for(; i < text.size(); ++i)
+		{
+			char c = text[i];
+			if(c == '_')
+				continue;
+			if(c == 'i' || c == 'u')
+				break;
+			if(digitTable[std::uint8_t(c)] >= radix)
+				return result.error = "invalid digit in number", result;
+			any = true;
+			if(count == 0 && c == '0')
+				continue;
+			if(count == sizeof digits)
+				return result.error = "number is too large", result;
+			digits[count++] = c;
+		}
+
+		if(!any)
+			return result.error = "number has no digits", result;
+
+		if(i < text.size())
+		{
+			result.type = parseSuffix(text.substr(i));
+			result.suffixed = true;
+			if(result.type == NumericType::unknown)
+				return result.error = "unknown suffix on number", result;
+		}
+
+		if(!convertDigits({digits, count}, radix, result.value))
+			return result.error = "number is too large", result;
+
+		if(!result.suffixed)
+			result.type = getSuitableIntegerTypeFor(result.value);
+		else if(!fitsNumericType(result.value, result.type))
+			return result.error = "number does not fit its suffix type", result;
+
+		return result;
+	}
+
+	auto isFloatLiteral(std::string_view text) -> bool
+	{
+		// Hex digits include `e` and `f`.
+		for(auto prefix : {"0x", "0X", "0b", "0B"})
+			if(text.starts_with(prefix))
+				return false;
+		return text.find_first_of(".eEf") != std::string_view::npos;
+	}
+
+	auto parseFloatLiteral(std::string_view text) -> FloatLiteral
+	{
+		FloatLiteral result;
+
+		if(auto f = text.find('f'); f != std::string_view::npos)
+		{
+			auto suffix = getNumericTypeByName(text.substr(f));
+			if(!isFloatingNumericType(suffix))
+				return result.error = "unknown suffix on number", result;
+			result.type = suffix;
+			result.suffixed = true;
+			text = text.substr(0, f);
+		}
+
+		char digits[128];
+		std::size_t count = 0;
+		for(char c : text)
+		{
+			if(c == '_')
+				continue;
+			if(count == sizeof digits)
+				return result.error = "number is too long", result;
+			digits[count++] = c;
+		}
+
+		auto [end, ec] = std::from_chars(digits, digits + count, result.value);
+		if(ec == std::errc::result_out_of_range)
+			return result.error = "number is out of range", result;
+		if(ec != std::errc() || end != digits + count)
+			return result.error = "malformed number", result;
+
+		if(result.type == NumericType::f32 && std::isinf(float(result.value)))
+			return result.error = "number does not fit its suffix type", result;
+		return result;
+	}
+}
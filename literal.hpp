@@ -0,0 +1,36 @@
+#pragma once
+#include "types.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+namespace noct
+{
+	struct IntegerLiteral
+	{
+		std::uint64_t value = 0;
+		NumericType   type  = NumericType::unknown;
+		bool          suffixed = false;
+		const char   *error = nullptr; // set when the literal is malformed or overflows
+	};
+
+	// Parses a number token: `123`, `0x7f`, `0b1010`, with `_` separators anywhere
+	// after the first digit and an optional `i8`...`u64` suffix. Without a suffix
+	// the type is the narrowest of i32, u32, i64 and u64 that holds the value.
+	auto parseIntegerLiteral(std::string_view text) -> IntegerLiteral;
+
+	struct FloatLiteral
+	{
+		double      value = 0;
+		NumericType type  = NumericType::f64;
+		bool        suffixed = false;
+		const char *error = nullptr;
+	};
+
+	// Whether a number token is a floating-point literal: a decimal one with a
+	// fraction, an exponent or an `f32`/`f64` suffix.
+	auto isFloatLiteral(std::string_view text) -> bool;
+
+	// Parses `1.5`, `2.5e-3`, `1_000.25` or `3f32`. Without a suffix it is an f64.
+	auto parseFloatLiteral(std::string_view text) -> FloatLiteral;
+}
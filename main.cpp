@@ -1,14 +1,73 @@
 #include "util.hpp"
+#include "analysis.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
 #include "codegen.hpp"
+#include "consteval.hpp"
+#include "generic.hpp"
+#include "repl.hpp"
+#include "log.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
 
 auto main(int argc, char *argv[]) -> int
 {
-	if(argc < 3)
+	std::vector<const char *> args;
+	int                       optimizationLevel = 0;
+	std::string               targetCPU = "generic";
+	bool                      instrumentFunctions = false;
+	bool                      freestanding = false;
+	const char               *profileGenerate = nullptr;
+	const char               *profileUse = nullptr;
+	bool                      thinLTO = false;
+	std::string               boundsChecks = "elide";
+	std::string               output;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--repl") == 0)
+			return noct::runRepl(std::cin, std::cout);
+		else if(std::strncmp(argv[i], "-O", 2) == 0)
+			optimizationLevel = std::atoi(argv[i] + 2);
+		else if(std::strncmp(argv[i], "-mcpu=", 6) == 0)
+			targetCPU = argv[i] + 6;
+		else if(std::strcmp(argv[i], "-finstrument-functions") == 0)
+			instrumentFunctions = true;
+		else if(std::strcmp(argv[i], "-ffreestanding") == 0)
+			freestanding = true;
+		else if(std::strcmp(argv[i], "-fprofile-instr-generate") == 0)
+			profileGenerate = "default_%m.profraw";
+		else if(std::strncmp(argv[i], "-fprofile-instr-generate=", 25) == 0)
+			profileGenerate = argv[i] + 25;
+		else if(std::strncmp(argv[i], "-fprofile-instr-use=", 20) == 0)
+			profileUse = argv[i] + 20;
+		else if(std::strcmp(argv[i], "-flto=thin") == 0)
+			thinLTO = true;
+		else if(std::strncmp(argv[i], "-fbounds-checks=", 16) == 0)
+		{
+			boundsChecks = argv[i] + 16;
+			if(boundsChecks != "elide" && boundsChecks != "all" && boundsChecks != "none")
+			{
+				noct::error("Unknown bounds checks '{0}'; expected elide, all or none.",
+				            boundsChecks);
+				return 1;
+			}
+		}
+		else if(std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else
+			args.push_back(argv[i]);
+	}
+
+	if(output.empty() && args.size() >= 2)
+		output = args[1];
+
+	if(args.empty() || output.empty())
 		return 1;
 
-	std::ifstream inp(argv[1]);
+	std::ifstream inp(args[0]);
 	if(!inp)
 		return 1;
 
@@ -30,6 +89,11 @@ auto main(int argc, char *argv[]) -> int
 
 	auto parser = noct::Parser();
 	auto program = parser.parseProgram(it);
+	if(parser.errors != 0)
+	{
+		parser.printDiagnostics();
+		return 1;
+	}
 
 	noct::TypecheckEnv typecheckEnv;
 	for(const auto &node : program)
@@ -39,22 +103,71 @@ auto main(int argc, char *argv[]) -> int
 		if(node->type(typecheckEnv).error)
 		{
 			std::cout << "Type error!" << std::endl;
-			break;
+			return 1;
 		}
 	}
 
-	noct::Generator gen(argv[1]);
+	noct::monomorphize(program, typecheckEnv);
+	noct::inferLinkage(program);
+
+	noct::ConstEvaluator constEvaluator;
+	for(const auto &n : program) constEvaluator.declare(n);
+	for(auto &n : program)
+		if(!constEvaluator.fold(n))
+			return 1;
+
+	// Folding may have removed the last reference to some of them.
+	noct::eliminateDeadDeclarations(program);
+
+	// -fbounds-checks=all keeps the checks that could be proven away, and =none
+	// drops every check.
+	if(boundsChecks == "elide")
+		for(const auto &n : program) noct::eliminateBoundsChecks(n.get());
+
+	noct::Generator gen(args[0]);
+	gen.set(noct::GeneratorOpt::InstrumentFunctions,
+	        noct::GeneratorBool(instrumentFunctions));
+	gen.set(noct::GeneratorOpt::BoundsChecks, noct::GeneratorBool(boundsChecks != "none"));
 
 	for(const auto &n : program) gen.generate(n.get());
 
-	gen.set(noct::GeneratorOpt::ShouldOutputObject, noct::GeneratorBool::Yes);
-	gen.set(noct::GeneratorOpt::OutputObjectFile, std::string(argv[2]));
+	// Like clang -flto=thin -c: the output file holds bitcode instead of machine code.
+	// Anything not named *.o is linked into an executable right away.
+	if(thinLTO)
+	{
+		gen.set(noct::GeneratorOpt::ShouldOutputBitcode, noct::GeneratorBool::Yes);
+		gen.set(noct::GeneratorOpt::OutputBitcodeFile, output);
+	}
+	else if(output.size() > 2 && output.compare(output.size() - 2, 2, ".o") == 0)
+	{
+		gen.set(noct::GeneratorOpt::ShouldOutputObject, noct::GeneratorBool::Yes);
+		gen.set(noct::GeneratorOpt::OutputObjectFile, output);
+	}
+	else
+	{
+		gen.set(noct::GeneratorOpt::ShouldOutputExecutable, noct::GeneratorBool::Yes);
+		gen.set(noct::GeneratorOpt::OutputExecutableFile, output);
+	}
 	gen.set(noct::GeneratorOpt::ShouldOutputIR, noct::GeneratorBool::Yes);
-	gen.set(noct::GeneratorOpt::OutputIRFile, std::string(argv[2]) + ".ll");
-	gen.output();
+	gen.set(noct::GeneratorOpt::OutputIRFile, output + ".ll");
+	gen.set(noct::GeneratorOpt::OptimizationLevel, optimizationLevel);
+	gen.set(noct::GeneratorOpt::TargetCPU, targetCPU);
+	gen.set(noct::GeneratorOpt::Freestanding, noct::GeneratorBool(freestanding));
+
+	if(profileGenerate != nullptr)
+	{
+		gen.set(noct::GeneratorOpt::ShouldGenerateProfile, noct::GeneratorBool::Yes);
+		gen.set(noct::GeneratorOpt::ProfileGenerateFile, std::string(profileGenerate));
+	}
+	if(profileUse != nullptr)
+	{
+		gen.set(noct::GeneratorOpt::ShouldUseProfile, noct::GeneratorBool::Yes);
+		gen.set(noct::GeneratorOpt::ProfileUseFile, std::string(profileUse));
+	}
+	bool written = gen.output();
 
 	std::cout.flush();
 	inp.close();
 
-	return 0;
+	return written ? 0 : 1;
 }
@@ -1,6 +1,11 @@
 #include "parser.hpp"
 #include "fmt.hpp"
 #include "log.hpp"
+#include "literal.hpp"
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
 
 namespace noct
 {
@@ -16,13 +21,130 @@ namespace noct
 			return "expected " + msg + ", but got " + type;
 		}
 
+		struct BindingPower
+		{
+			std::uint8_t left = 0, right = 0;
+		};
+
+		// How strongly each infix operator binds, indexed by token type. A token
+		// with no entry ends the expression. Every operator is left-associative,
+		// so it binds a little more strongly on its right.
+		constexpr auto infixBindingPowers = [] {
+			std::array<BindingPower, 128> table{};
+			std::uint8_t                  power = 1;
+			for(auto level : {
+			        std::initializer_list<int>{TokenType::opr_d_bar},
+			        {TokenType::opr_d_amp},
+			        {'|'},
+			        {'^'},
+			        {'&'},
+			        {TokenType::opr_equal, TokenType::opr_noteq},
+			        {'<', '>', TokenType::opr_lteql, TokenType::opr_gteql},
+			        {TokenType::opr_shftl, TokenType::opr_shftr},
+			        {'+', '-', TokenType::opr_wradd, TokenType::opr_wrsub, TokenType::opr_chadd,
+			         TokenType::opr_chsub},
+			        {'*', '/', '%', TokenType::opr_wrmul, TokenType::opr_chmul},
+			    })
+			{
+				for(auto op : level) table[op] = {power, std::uint8_t(power + 1)};
+				power += 2;
+			}
+			return table;
+		}();
+
+		// Above every infix operator: -a * b is (-a) * b.
+		constexpr std::uint8_t prefixBindingPower = 21;
+
+		constexpr auto getInfixBindingPower(char type) -> BindingPower
+		{
+			return type >= 0 ? infixBindingPowers[type] : BindingPower{};
+		}
+
+		static_assert(getInfixBindingPower('*').left > getInfixBindingPower('+').left);
+		static_assert(prefixBindingPower > getInfixBindingPower('*').right);
+
+		auto startsTopLevel(char type) -> bool
+		{
+			return type == TokenType::kwd_fn || type == TokenType::kwd_let
+			    || type == TokenType::kwd_pub || type == TokenType::kwd_struct || type == '@';
+		}
+
+		struct DepthGuard
+		{
+			std::size_t &depth;
+			DepthGuard(std::size_t &depth) : depth(++depth) {}
+			~DepthGuard() { --depth; }
+		};
+
+		// Gives back the links a chain added, once it is done.
+		struct ChainGuard
+		{
+			std::size_t &links, outer;
+			ChainGuard(std::size_t &links) : links(links), outer(links) {}
+			~ChainGuard() { links = outer; }
+		};
+
 	} // namespace
 
+	void Parser::report(const std::string &msg)
+	{
+		if(panicking)
+			return;
+
+		panicking = true;
+		if(errors++ < maxDiagnostics)
+			diagnostics.push_back(msg);
+	}
+
+	void Parser::printDiagnostics()
+	{
+		for(const auto &d : diagnostics) error("{0}", d);
+		if(errors > diagnostics.size())
+			error("... and {0} more errors", errors - diagnostics.size());
+		diagnostics.clear();
+	}
+
+	// Panic mode: skip to the end of the statement, or to something that starts or
+	// ends one. Every token is looked at once, so recovery stays linear.
+	void Parser::synchronize(It &it)
+	{
+		while(true)
+		{
+			auto t = it.peek().type;
+			if(t == TokenType::eof || t == '}' || startsTopLevel(t))
+				break;
+			it.get();
+			if(t == ';')
+				break;
+		}
+		panicking = false;
+	}
+
+	// Drops a token that cannot be parsed, but leaves the ones recovery stops at.
+	// Statements never start with one of those, so a statement still always
+	// consumes something.
+	void Parser::skipUnlessSynchronizing(It &it)
+	{
+		auto t = it.peek().type;
+		if(t != TokenType::eof && t != ';' && t != '}' && !startsTopLevel(t))
+			it.get();
+	}
+
+	bool Parser::extendChain(It &it)
+	{
+		if(++links <= maxLinks)
+			return true;
+
+		report("expressions are chained too long");
+		skipUnlessSynchronizing(it);
+		return false;
+	}
+
 	bool Parser::expect(It &it, char type, const std::string &msg)
 	{
 		if(it.peek().type != type)
 		{
-			error(expectedErrorMessage(msg, it.peek()));
+			report(expectedErrorMessage(msg, it.peek()));
 			return false;
 		}
 
@@ -55,74 +177,440 @@ namespace noct
 				return makePtr<TypeNumeric>(NumericType::u16);
 			if(t.value == "u8")
 				return makePtr<TypeNumeric>(NumericType::u8);
+			if(t.value == "f32")
+				return makePtr<TypeNumeric>(NumericType::f32);
+			if(t.value == "f64")
+				return makePtr<TypeNumeric>(NumericType::f64);
+			if(auto v = getVectorTypeByName(t.value); v != nullptr)
+				return v;
+			for(const auto &p : typeParameters)
+				if(p->name == t.value)
+					return p;
+			if(auto s = structs.find(t.value); s != structs.end())
+				return s->second;
+
+			report(format("unknown type '{0}'", t.value));
 			return nullptr;
 		}
-		error(expectedErrorMessage("a type", t));
+		report(expectedErrorMessage("a type", t));
 		return nullptr;
 	}
 
 	Ptr<Type> Parser::parseTypeSuffix(It &it, const Ptr<Type> &base)
 	{
-		if(it.peek().type == '*')
+		bool isStruct = dynamic_cast<TypeStruct *>(base.get()) != nullptr;
+		if(base != nullptr && it.peek().type == '*')
+		{
+			it.get();
+			if(isStruct)
+			{
+				report("pointers can only point to numbers and vectors");
+				return nullptr;
+			}
 			return makePtr<TypePointer>(base);
+		}
+
+		// `T[N]` is an array and `T[]` a slice, of scalars, vectors or structs.
+		if(base != nullptr && it.peek().type == '[')
+		{
+			it.get();
+			if(base->type != TypeType::numeric && base->type != TypeType::vector
+			   && base->type != TypeType::parameter && !isStruct)
+			{
+				report("arrays can only hold numbers, vectors and structs");
+				return nullptr;
+			}
+
+			if(it.peek().type == ']')
+			{
+				it.get();
+				return makePtr<TypeSlice>(base);
+			}
+
+			auto t = it.peek();
+			if(!expectAndGet(it, TokenType::num, "an array length"))
+				return nullptr;
+			auto count = parseIntegerLiteral(t.value);
+			if(count.error != nullptr || count.value == 0 || count.value > 0xFFFFFFFF)
+			{
+				report(format("invalid array length '{0}'", t.value));
+				return nullptr;
+			}
+
+			expectAndGet(it, ']', "a closing ']' for the array type");
+			return makePtr<TypeArray>(base, count.value);
+		}
 		return base;
 	}
 
 	Ptr<Type> Parser::parseType(It &it)
 	{
-		return parseTypeSuffix(it, parseTypeAtomic(it));
+		PointerQualifiers qualifiers;
+		for(;; it.get())
+			if(it.peek().type == TokenType::kwd_restrict)
+				qualifiers.restrict = true;
+			else if(it.peek().type == TokenType::kwd_readonly)
+				qualifiers.readonly = true;
+			else
+				break;
+
+		// `@soa P[N]`: an array of structs kept as one array per field.
+		bool soa = false;
+		if(it.peek().type == '@')
+		{
+			it.get();
+			auto a = it.peek();
+			if(!expectAndGet(it, TokenType::idn, "an attribute name"))
+				return nullptr;
+			if(a.value != "soa")
+			{
+				report(format("unknown type attribute '{0}'", a.value));
+				return nullptr;
+			}
+			soa = true;
+		}
+
+		auto t = parseTypeSuffix(it, parseTypeAtomic(it));
+		if(t != nullptr && soa)
+		{
+			if(getStructElement(t) == nullptr)
+			{
+				report("only arrays and slices of structs can be @soa");
+				return nullptr;
+			}
+			if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr)
+				a->soa = true;
+			else
+				static_cast<TypeSlice *>(t.get())->soa = true;
+		}
+		if(t == nullptr || (!qualifiers.restrict && !qualifiers.readonly))
+			return t;
+
+		if(auto p = dynamic_cast<TypePointer *>(t.get()); p != nullptr)
+			p->qualifiers = qualifiers;
+		else if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+			s->qualifiers = qualifiers;
+		else
+		{
+			report("only pointers and slices can be restrict or readonly");
+			return nullptr;
+		}
+		return t;
 	}
 
 	Ptr<AST> Parser::parseSuffix(It &it, const Ptr<AST> &base)
 	{
-		return nullptr;
+		auto result = base;
+		if(auto idn = dynamic_cast<ASTIdn *>(base.get()); idn != nullptr && it.peek().type == '(')
+		{
+			auto call = makePtr<ASTCall>(idn->name);
+			it.get();
+			while(it.peek().type != ')' && it.peek().type != TokenType::eof)
+			{
+				call->args.push_back(parseExpr(it));
+				if(it.peek().type != ',')
+					break;
+				it.get();
+			}
+			expectAndGet(it, ')', "a closing ')' for the call");
+			result = call;
+		}
+
+		ChainGuard chain(links);
+		while(it.peek().type == '[' || it.peek().type == '.')
+		{
+			if(!extendChain(it))
+				return nullptr;
+			if(it.get().type == '.')
+			{
+				auto t = it.peek();
+				if(!expectAndGet(it, TokenType::idn, "a field name"))
+					return nullptr;
+				result = makePtr<ASTField>(result, t.value);
+				continue;
+			}
+
+			auto index = parseExpr(it);
+			expectAndGet(it, ']', "a closing ']' for the index");
+			if(index == nullptr)
+				return nullptr;
+			result = makePtr<ASTIndex>(result, index);
+		}
+
+		return result;
 	}
 
 	Ptr<AST> Parser::parseAtomic(It &it)
 	{
-		auto t = it.get();
-		if(t.type == TokenType::num)
-			return makePtr<ASTInt>(std::stoull(t.value));
-		if(t.type == TokenType::idn)
-			return makePtr<ASTIdn>(t.value);
+		if(it.peek().type == '{')
+			return parseBlock(it);
+		if(it.peek().type == '@')
+			return parseAttributedBlock(it);
+		if(it.peek().type == TokenType::kwd_if)
+			return parseIf(it);
+		if(it.peek().type == TokenType::kwd_while)
+			return parseWhile(it);
+		if(it.peek().type == TokenType::kwd_parallel)
+			return parseParallel(it);
+		if(it.peek().type == '(')
+		{
+			it.get();
+			auto e = parseExpr(it);
+			expectAndGet(it, ')', "a closing ')'");
+			return e;
+		}
 
-		error("expected a number or a variable!");
+		if(it.peek().type == TokenType::num)
+		{
+			auto t = it.get();
+			if(isFloatLiteral(t.value))
+			{
+				auto literal = parseFloatLiteral(t.value);
+				if(literal.error != nullptr)
+				{
+					report(format("{0} '{1}'", literal.error, t.value));
+					return nullptr;
+				}
+				return makePtr<ASTFloat>(literal.value, literal.type, literal.suffixed);
+			}
+
+			auto literal = parseIntegerLiteral(t.value);
+			if(literal.error != nullptr)
+			{
+				report(format("{0} '{1}'", literal.error, t.value));
+				return nullptr;
+			}
+			return makePtr<ASTInt>(literal.value, literal.type, literal.suffixed);
+		}
+		if(it.peek().type == TokenType::idn)
+			return makePtr<ASTIdn>(it.get().value);
+
+		report(expectedErrorMessage("an expression", it.peek()));
+		skipUnlessSynchronizing(it);
 		return nullptr;
 	}
 
 	Ptr<AST> Parser::parsePrefix(It &it)
 	{
-		return nullptr;
+		// Everything that nests comes through here, blocks included.
+		DepthGuard guard(depth);
+		if(depth > maxDepth)
+		{
+			report("expressions are nested too deeply");
+			skipUnlessSynchronizing(it);
+			return nullptr;
+		}
+
+		auto op = it.peek().type;
+		if(op == '-' || op == '!' || op == '~')
+		{
+			it.get();
+			auto operand = parseInfix(it, prefixBindingPower);
+			if(operand == nullptr)
+				return nullptr;
+			return makePtr<ASTUnary>(op, operand);
+		}
+
+		auto atom = parseAtomic(it);
+		if(atom == nullptr)
+			return nullptr;
+		return parseSuffix(it, atom);
 	}
 
-	Ptr<AST> Parser::parseInfix(It &it)
+	// Pratt parsing: recursion only goes as deep as the operators actually nest,
+	// however many precedence levels there are.
+	Ptr<AST> Parser::parseInfix(It &it, std::uint8_t minPower)
 	{
-		return nullptr;
+		ChainGuard chain(links);
+		auto       lhs = parsePrefix(it);
+		while(lhs != nullptr)
+		{
+			auto op = it.peek().type;
+			auto power = getInfixBindingPower(op);
+			if(power.left == 0 || power.left < minPower)
+				break;
+			if(!extendChain(it))
+				return nullptr;
+
+			it.get();
+			auto rhs = parseInfix(it, power.right);
+			if(rhs == nullptr)
+				return nullptr;
+			lhs = makePtr<ASTBinary>(op, lhs, rhs);
+		}
+		return lhs;
 	}
 
 	Ptr<AST> Parser::parseExpr(It &it)
 	{
-		return parseAtomic(it);
+		return parseInfix(it, 0);
 	}
 
 	Ptr<AST> Parser::parseStmt(It &it)
 	{
-		return parseExpr(it);
+		if(it.peek().type == TokenType::kwd_let)
+		{
+			auto v = parseVariable(it);
+			static_cast<ASTVar *>(v.get())->decl.local = true;
+			return v;
+		}
+
+		auto e = parseExpr(it);
+		if(it.peek().type != '=')
+			return e;
+
+		// Either a whole variable, a single element of one, or a field of either.
+		auto field = dynamic_cast<ASTField *>(e.get());
+		auto target = field != nullptr ? field->base.get() : e.get();
+		auto element = dynamic_cast<ASTIndex *>(target);
+		auto idn = dynamic_cast<ASTIdn *>(element != nullptr ? element->base.get() : target);
+		if(idn != nullptr)
+		{
+			it.get();
+			auto a = makePtr<ASTAssign>(idn->name);
+			a->index = element != nullptr ? element->index : nullptr;
+			a->field = field != nullptr ? field->field : "";
+			a->value = parseExpr(it);
+			return a;
+		}
+		return e;
 	}
 
 	Ptr<AST> Parser::parseBlock(It &it)
 	{
 		auto b = makePtr<ASTBlock>();
-		expect(it, '{', "an opening '{' for a block") &&it.get();
+		if(!expectAndGet(it, '{', "an opening '{' for a block"))
+			return nullptr;
 
-		while(it.peek().type != '}')
-			b->nodes.push_back(parseStmt(it));
+		// A function further down means this block was never closed. A `let` or
+		// attributes on a block still belong in it.
+		while(it.peek().type != '}' && it.peek().type != TokenType::eof
+		      && (!startsTopLevel(it.peek().type) || it.peek().type == TokenType::kwd_let
+		          || it.peek().type == '@'))
+		{
+			// Semicolons only separate statements.
+			if(it.peek().type == ';')
+			{
+				it.get();
+				continue;
+			}
+
+			// A statement with an error is dropped; whatever follows it is still
+			// checked. Each attempt consumes at least one token.
+			auto before = errors;
+			auto stmt = parseStmt(it);
+			if(stmt != nullptr && errors == before)
+				b->nodes.push_back(stmt);
+			else if(panicking)
+				synchronize(it);
+		}
 
-		expect(it, '}', "a closing '}' for a block") &&it.get();
+		expectAndGet(it, '}', "a closing '}' for a block");
 		return b;
 	}
 
-	Ptr<AST> Parser::parseReturn(It &it)
+	// `@fastmath { ... }`, or a plain block.
+	Ptr<AST> Parser::parseAttributedBlock(It &it)
+	{
+		if(it.peek().type != '@')
+			return parseBlock(it);
+
+		auto attributes = parseAttributes(it);
+		if(it.peek().type != '{')
+		{
+			report(expectedErrorMessage("a block after the attributes", it.peek()));
+			return nullptr;
+		}
+		auto b = parseBlock(it);
+		if(b != nullptr)
+			static_cast<ASTBlock *>(b.get())->attributes = std::move(attributes);
+		return b;
+	}
+
+	Ptr<AST> Parser::parseIf(It &it)
+	{
+		auto i = makePtr<ASTIf>();
+		expectAndGet(it, TokenType::kwd_if, "the 'if' keyword");
+		i->cond = parseExpr(it);
+		i->then = parseAttributedBlock(it);
+
+		if(it.peek().type == TokenType::kwd_else)
+		{
+			it.get();
+			ChainGuard chain(links);
+			if(it.peek().type != TokenType::kwd_if)
+				i->otherwise = parseAttributedBlock(it);
+			else if(extendChain(it))
+				i->otherwise = parseIf(it);
+			else
+				return nullptr;
+		}
+		return i;
+	}
+
+	Ptr<AST> Parser::parseWhile(It &it)
+	{
+		auto w = makePtr<ASTWhile>();
+		expectAndGet(it, TokenType::kwd_while, "the 'while' keyword");
+		w->cond = parseExpr(it);
+		w->body = parseBlock(it);
+		return w;
+	}
+
+	// `parallel for i in lo..hi { ... }` or `parallel reduce(op) i in lo..hi { ... }`.
+	// Only `parallel` is a keyword: the words after it can still name variables.
+	Ptr<AST> Parser::parseParallel(It &it)
+	{
+		auto p = makePtr<ASTParallel>();
+		expectAndGet(it, TokenType::kwd_parallel, "the 'parallel' keyword");
+
+		auto isWord = [&](const char *word) {
+			return it.peek().type == TokenType::idn && it.peek().value == word;
+		};
+		if(isWord("reduce"))
+		{
+			it.get();
+			if(!expectAndGet(it, '(', "an opening '(' for the operator"))
+				return nullptr;
+			p->op = it.get().type;
+			if(p->op != '+' && p->op != '*' && p->op != '&' && p->op != '|' && p->op != '^')
+			{
+				report("a parallel reduction combines with one of + * & | ^");
+				return nullptr;
+			}
+			if(!expectAndGet(it, ')', "a closing ')' for the operator"))
+				return nullptr;
+		}
+		else if(isWord("for"))
+			it.get();
+		else
+		{
+			report(expectedErrorMessage("'for' or 'reduce' after 'parallel'", it.peek()));
+			return nullptr;
+		}
+
+		auto var = it.peek();
+		if(!expectAndGet(it, TokenType::idn, "the loop variable"))
+			return nullptr;
+		p->var = var.value;
+		if(!isWord("in"))
+		{
+			report(expectedErrorMessage("'in' after the loop variable", it.peek()));
+			return nullptr;
+		}
+		it.get();
+
+		p->lo = parseExpr(it);
+		if(p->lo == nullptr || !expectAndGet(it, TokenType::opr_range, "'..' after the start"))
+			return nullptr;
+		p->hi = parseExpr(it);
+		p->body = parseBlock(it);
+		if(p->hi == nullptr || p->body == nullptr)
+			return nullptr;
+		return p;
+	}
+
+	Ptr<AST> Parser::parseReturn(It &)
 	{
 		return nullptr;
 	}
@@ -146,11 +634,41 @@ namespace noct
 			f->value = parseExpr(it);
 		}
 
-		expectAndGet(it, ';', "a semicolon");
+		// Reaching the semicolon recovers from anything before it.
+		if(expectAndGet(it, ';', "a semicolon"))
+			panicking = false;
 
 		return f;
 	}
 
+	std::vector<Attribute> Parser::parseAttributes(It &it)
+	{
+		std::vector<Attribute> attrs;
+		while(it.peek().type == '@')
+		{
+			it.get();
+			if(!expect(it, TokenType::idn, "an attribute name"))
+				break;
+
+			auto &attr = attrs.emplace_back();
+			attr.name = it.get().value;
+			if(it.peek().type != '(')
+				continue;
+
+			it.get();
+			while(it.peek().type == TokenType::idn || it.peek().type == TokenType::num)
+			{
+				attr.args.push_back(it.get().value);
+				if(it.peek().type != ',')
+					break;
+				it.get();
+			}
+			expectAndGet(it, ')', "a closing ')' for the attribute");
+		}
+
+		return attrs;
+	}
+
 	Ptr<AST> Parser::parseFunction(It &it)
 	{
 		auto f = makePtr<ASTFunc>();
@@ -161,34 +679,152 @@ namespace noct
 		else
 			f->decl.name = it.get().value;
 
-		// TODO: Arguments
+		// `<T: numeric, U>`: the parameters are types in the rest of the function.
+		if(it.peek().type == '<')
+		{
+			it.get();
+			while(it.peek().type == TokenType::idn)
+			{
+				auto name = it.get().value;
+				auto constraint = TypeConstraint::any;
+				if(it.peek().type == ':')
+				{
+					it.get();
+					auto t = it.peek();
+					if(expectAndGet(it, TokenType::idn, "a constraint"))
+					{
+						if(auto c = getTypeConstraintByName(t.value); c.has_value())
+							constraint = *c;
+						else
+							report(format("unknown constraint '{0}'", t.value));
+					}
+				}
+				f->decl.typeParams.push_back(makePtr<TypeParameter>(name, constraint));
+				if(it.peek().type != ',')
+					break;
+				it.get();
+			}
+			expectAndGet(it, '>', "a closing '>' for the type parameters");
+		}
+		typeParameters = f->decl.typeParams;
+
+		if(it.peek().type == '(')
+		{
+			it.get();
+			while(it.peek().type == TokenType::idn)
+			{
+				f->decl.argNames.push_back(it.get().value);
+				expectAndGet(it, ':', "a colon");
+				f->decl.signature.argTypes.push_back(parseType(it));
+				if(it.peek().type != ',')
+					break;
+				it.get();
+			}
+			expectAndGet(it, ')', "a closing ')' for the arguments");
+		}
 
 		expectAndGet(it, TokenType::opr_arrow, "a return type arrow");
 
 		f->decl.signature.returnType = parseType(it);
 
 		f->body = parseBlock(it);
+		typeParameters.clear();
 
 		return f;
 	}
 
+	// `struct Name { field: type, ... }`. It is a type from here on.
+	Ptr<AST> Parser::parseStruct(It &it)
+	{
+		auto s = makePtr<ASTStruct>();
+		expectAndGet(it, TokenType::kwd_struct, "the 'struct' keyword");
+
+		auto name = it.peek();
+		if(!expectAndGet(it, TokenType::idn, "the struct's name"))
+			return nullptr;
+		if(structs.contains(name.value) || getNumericTypeByName(name.value) != NumericType::unknown
+		   || getVectorTypeByName(name.value) != nullptr)
+		{
+			report(format("type '{0}' is already declared", name.value));
+			return nullptr;
+		}
+		s->decl = makePtr<TypeStruct>(name.value);
+
+		expectAndGet(it, '{', "an opening '{' for the fields");
+		while(it.peek().type == TokenType::idn)
+		{
+			auto &f = s->decl->fields.emplace_back();
+			f.name = it.get().value;
+			expectAndGet(it, ':', "a colon");
+			f.type = parseType(it);
+			if(f.type == nullptr)
+				return nullptr;
+			if(it.peek().type != ',')
+				break;
+			it.get();
+		}
+		if(expectAndGet(it, '}', "a closing '}' for the fields"))
+			panicking = false;
+
+		structs[name.value] = s->decl;
+		return s;
+	}
+
 	Ptr<AST> Parser::parseTopLevel(It &it)
 	{
-		if(it.peek().type == TokenType::kwd_fn)
-			return parseFunction(it);
+		if(!startsTopLevel(it.peek().type))
+		{
+			report(expectedErrorMessage("a top-level item", it.peek()));
+			while(it.peek().type != TokenType::eof && !startsTopLevel(it.peek().type))
+				it.get();
+			return nullptr;
+		}
+		panicking = false;
+
+		bool exported = false;
+		while(it.peek().type == TokenType::kwd_pub)
+		{
+			it.get();
+			exported = true;
+		}
 
+		auto attributes = parseAttributes(it);
+		if(it.peek().type == TokenType::kwd_struct && !exported)
+		{
+			auto s = parseStruct(it);
+			if(s != nullptr)
+				static_cast<ASTStruct *>(s.get())->attributes = std::move(attributes);
+			return s;
+		}
+		if(it.peek().type == TokenType::kwd_fn || !attributes.empty())
+		{
+			auto f = parseFunction(it);
+			auto func = static_cast<ASTFunc *>(f.get());
+			func->decl.exported = exported;
+			func->decl.attributes = std::move(attributes);
+			return f;
+		}
 		if(it.peek().type == TokenType::kwd_let)
-			return parseVariable(it);
+		{
+			auto v = parseVariable(it);
+			static_cast<ASTVar *>(v.get())->decl.exported = exported;
+			return v;
+		}
 
-		error(expectedErrorMessage("Expected a top-level statement.", it.get()));
-		return parseTopLevel(it);
+		report(expectedErrorMessage("a function or a variable after 'pub'", it.peek()));
+		return nullptr;
 	}
 
 	std::vector<Ptr<AST>> Parser::parseProgram(It &it)
 	{
 		std::vector<Ptr<AST>> prog;
 
-		while(it.peek().type != TokenType::eof) prog.push_back(parseTopLevel(it));
+		while(it.peek().type != TokenType::eof)
+		{
+			auto before = errors;
+			if(auto node = parseTopLevel(it); node != nullptr && errors == before)
+				prog.push_back(node);
+		}
 
 		return prog;
 	}
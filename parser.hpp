@@ -4,12 +4,39 @@
 #include "lexer.hpp"
 #include "ast.hpp"
 
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 namespace noct
 {
 	struct Parser
 	{
 		using It = BufferedIterator<Token, TokenIterator>;
 
+		// Diagnostics are collected rather than printed, and only the first error of
+		// each statement is reported: after it, the parser skips ahead to a point
+		// where it can resynchronize.
+		static constexpr std::size_t maxDiagnostics = 100;
+		static constexpr std::size_t maxDepth = 256;
+		// Operator, suffix and `else if` chains nest in the tree without nesting in
+		// the parser; later passes still walk them recursively.
+		static constexpr std::size_t maxLinks = 4096;
+
+		std::size_t errors = 0;
+		std::vector<std::string> diagnostics;
+		bool panicking = false;
+		std::size_t depth = 0;
+		std::size_t links = 0; // in the chains around the current expression
+		std::vector<Ptr<TypeParameter>> typeParameters; // of the function being parsed
+		std::unordered_map<std::string, Ptr<TypeStruct>> structs; // declared so far
+
+		void report(const std::string &msg);
+		void printDiagnostics();
+		void synchronize(It &it);
+		void skipUnlessSynchronizing(It &it);
+		bool extendChain(It &it);
+
 		bool expect(It &it, char type, const std::string &msg = "");
 		bool expectAndGet(It &it, char type, const std::string &msg = "");
 
@@ -20,12 +47,18 @@ namespace noct
 		Ptr<AST> parseSuffix(It &it, const Ptr<AST> &b);
 		Ptr<AST> parseAtomic(It &it);
 		Ptr<AST> parsePrefix(It &it);
-		Ptr<AST> parseInfix(It &it);
+		Ptr<AST> parseInfix(It &it, std::uint8_t minPower);
 		Ptr<AST> parseExpr(It &it);
 		Ptr<AST> parseStmt(It &it);
 		Ptr<AST> parseBlock(It &it);
+		Ptr<AST> parseAttributedBlock(It &it);
+		Ptr<AST> parseIf(It &it);
+		Ptr<AST> parseWhile(It &it);
+		Ptr<AST> parseParallel(It &it);
 		Ptr<AST> parseReturn(It &it);
+		std::vector<Attribute> parseAttributes(It &it);
 		Ptr<AST> parseFunction(It &it);
+		Ptr<AST> parseStruct(It &it);
 		Ptr<AST> parseVariable(It &it);
 		Ptr<AST> parseTopLevel(It &it);
 		std::vector<Ptr<AST>> parseProgram(It &it);
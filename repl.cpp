@@ -0,0 +1,361 @@
+#include "repl.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "codegen.hpp"
+#include "consteval.hpp"
+#include "analysis.hpp"
+#include "log.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+
+namespace noct
+{
+	namespace
+	{
+		// The name a top-level item declares, if any.
+		auto declaredName(const AST *node) -> std::string
+		{
+			if(auto f = dynamic_cast<const ASTFunc *>(node); f != nullptr)
+				return f->decl.name;
+			if(auto v = dynamic_cast<const ASTVar *>(node); v != nullptr)
+				return v->decl.name;
+			return "";
+		}
+
+		struct Session
+		{
+			std::unique_ptr<llvm::orc::LLJIT> jit;
+			llvm::orc::ThreadSafeContext      context;
+			Generator                         gen;
+			TypecheckEnv                      typecheckEnv;
+			ConstEvaluator                    constEvaluator;
+			std::vector<Ptr<AST>>             generics; // instances are made from them later
+			std::unordered_map<std::string, Ptr<TypeStruct>> structs; // for every later line
+			std::size_t                       expressions = 0;
+
+			Session(std::unique_ptr<llvm::orc::LLJIT> jit)
+				: jit(std::move(jit)),
+				  context(std::make_unique<llvm::LLVMContext>()),
+				  gen("repl", *context.getContext())
+			{
+				constEvaluator.readGlobal = [this](const ASTVar &v) { return read(v); };
+			}
+
+			// The current value of a global defined on an earlier line.
+			auto read(const ASTVar &v) -> std::optional<ConstValue>
+			{
+				auto numeric = dynamic_cast<TypeNumeric *>(v.decl.type.get());
+				if(numeric == nullptr)
+					return std::nullopt;
+				auto symbol = jit->lookup(v.decl.name);
+				if(!symbol)
+				{
+					llvm::consumeError(symbol.takeError());
+					return std::nullopt;
+				}
+
+				auto *address = reinterpret_cast<const void *>(symbol->getAddress());
+				std::uint64_t bits = 0;
+				if(numeric->numeric == NumericType::f32)
+				{
+					float f;
+					std::memcpy(&f, address, sizeof f);
+					bits = std::bit_cast<std::uint64_t>(double(f));
+				}
+				else // the low bytes, on a little-endian host
+					std::memcpy(&bits, address, getNumericTypeWidth(numeric->numeric));
+				return ConstValue{bits, numeric->numeric};
+			}
+
+			bool add(const llvm::orc::ResourceTrackerSP &tracker)
+			{
+				auto m = llvm::orc::ThreadSafeModule(gen.takeModule(), context);
+				if(auto err = jit->addIRModule(tracker, std::move(m)))
+				{
+					error("{0}", llvm::toString(std::move(err)));
+					return false;
+				}
+				return true;
+			}
+
+			void define(Ptr<AST> node)
+			{
+				// A function is declared before its body is checked. When the check
+				// fails, the name must not stay callable with nothing behind it.
+				auto name = declaredName(node.get());
+				bool fresh = !name.empty() && !typecheckEnv.has(name);
+				if(node->type(typecheckEnv).error)
+				{
+					if(fresh)
+						typecheckEnv.erase(name);
+					error("Type error!");
+					return;
+				}
+
+				defineInstances();
+				if(auto f = dynamic_cast<ASTFunc *>(node.get());
+				   f != nullptr && !f->decl.typeParams.empty())
+				{
+					generics.push_back(node);
+					return;
+				}
+				// A struct is only a type; there is nothing to generate.
+				if(auto s = dynamic_cast<ASTStruct *>(node.get()); s != nullptr)
+				{
+					structs[s->decl->name] = s->decl;
+					return;
+				}
+				if(!emit(node) && fresh)
+					typecheckEnv.erase(name);
+			}
+
+			// Those the last line asked for: like the functions it defines, they stay.
+			void defineInstances()
+			{
+				for(auto &instance : typecheckEnv.takeInstances()) emit(instance);
+			}
+
+			bool emit(Ptr<AST> node)
+			{
+				constEvaluator.declare(node);
+				if(!constEvaluator.fold(node))
+					return false;
+				eliminateBoundsChecks(node.get());
+
+				// Later lines refer to it from modules of their own.
+				if(auto f = dynamic_cast<ASTFunc *>(node.get()); f != nullptr)
+					f->decl.exported = true;
+				else if(auto v = dynamic_cast<ASTVar *>(node.get()); v != nullptr)
+					v->decl.exported = true;
+
+				gen.generate(node.get());
+				return add(jit->getMainJITDylib().getDefaultResourceTracker());
+			}
+
+			template<typename T>
+			static auto call(llvm::JITTargetAddress address) -> T
+			{
+				return reinterpret_cast<T (*)()>(address)();
+			}
+
+			void evaluate(const Ptr<AST> &expr, std::ostream &out)
+			{
+				auto t = expr->type(typecheckEnv);
+				auto numeric = dynamic_cast<TypeNumeric *>(t.value.get());
+				if(t.error || numeric == nullptr)
+				{
+					error("Type error!");
+					return;
+				}
+				defineInstances();
+
+				// Wrap the expression in a function of its own, in a module that is
+				// thrown away once it has run.
+				auto wrapper = makePtr<ASTFunc>();
+				wrapper->decl.name = "__repl_expr" + std::to_string(expressions++);
+				wrapper->decl.exported = true;
+				wrapper->decl.signature.returnType = t.value;
+				wrapper->body = makePtr<ASTBlock>();
+				static_cast<ASTBlock *>(wrapper->body.get())->nodes.push_back(expr);
+
+				Ptr<AST> folded = wrapper;
+				constEvaluator.fold(folded);
+				eliminateBoundsChecks(folded.get());
+
+				auto tracker = jit->getMainJITDylib().createResourceTracker();
+				gen.generate(wrapper.get());
+				if(!add(tracker))
+					return;
+
+				auto symbol = jit->lookup(wrapper->decl.name);
+				if(!symbol)
+				{
+					error("{0}", llvm::toString(symbol.takeError()));
+					return;
+				}
+
+				auto address = symbol->getAddress();
+				out << getNumericTypeName(numeric->numeric) << " ";
+				switch(numeric->numeric)
+				{
+				case NumericType::i8:
+					out << (int)call<std::int8_t>(address);
+					break;
+				case NumericType::i16:
+					out << call<std::int16_t>(address);
+					break;
+				case NumericType::i32:
+					out << call<std::int32_t>(address);
+					break;
+				case NumericType::i64:
+					out << call<std::int64_t>(address);
+					break;
+				case NumericType::u8:
+					out << (unsigned)call<std::uint8_t>(address);
+					break;
+				case NumericType::u16:
+					out << call<std::uint16_t>(address);
+					break;
+				case NumericType::u32:
+					out << call<std::uint32_t>(address);
+					break;
+				case NumericType::u64:
+					out << call<std::uint64_t>(address);
+					break;
+				case NumericType::f32:
+					out << call<float>(address);
+					break;
+				case NumericType::f64:
+					out << call<double>(address);
+					break;
+				default:
+					out << "<cannot print>";
+					break;
+				}
+				out << std::endl;
+
+				if(auto err = tracker->remove())
+					error("{0}", llvm::toString(std::move(err)));
+			}
+
+			void run(const std::string &input, std::ostream &out)
+			{
+				std::istringstream in(input);
+				auto               l = Lexer{in};
+				auto               bl = BufferedIterable<Token, Lexer>(l);
+				auto               it = bl.begin();
+				Parser             parser;
+				parser.structs = structs;
+
+				// The whole line is parsed before any of it runs, so a syntax error
+				// anywhere leaves the session as it was.
+				std::vector<std::pair<Ptr<AST>, bool>> items; // and whether it is top-level
+				while(it.peek().type != TokenType::eof)
+				{
+					if(it.peek().type == ';')
+					{
+						it.get();
+						continue;
+					}
+
+					bool topLevel = it.peek().type == TokenType::kwd_fn
+					             || it.peek().type == TokenType::kwd_let
+					             || it.peek().type == TokenType::kwd_struct
+					             || it.peek().type == '@';
+					auto node = topLevel ? parser.parseTopLevel(it) : parser.parseStmt(it);
+
+					// Whatever follows a syntax error is not worth guessing at.
+					if(parser.errors != 0 || node == nullptr)
+					{
+						parser.printDiagnostics();
+						return;
+					}
+					items.emplace_back(std::move(node), topLevel);
+				}
+
+				for(auto &[node, topLevel] : items)
+					if(topLevel)
+						define(node);
+					else
+						evaluate(node, out);
+			}
+		};
+
+		auto createJIT() -> std::unique_ptr<llvm::orc::LLJIT>
+		{
+			llvm::InitializeNativeTarget();
+			llvm::InitializeNativeTargetAsmParser();
+			llvm::InitializeNativeTargetAsmPrinter();
+
+			auto machine = llvm::orc::JITTargetMachineBuilder::detectHost();
+			if(!machine)
+			{
+				error("{0}", llvm::toString(machine.takeError()));
+				return nullptr;
+			}
+
+			// Every line is compiled once and run once: codegen speed is what counts.
+			machine->setCodeGenOptLevel(llvm::CodeGenOpt::None);
+
+			auto jit = llvm::orc::LLJITBuilder()
+			               .setJITTargetMachineBuilder(std::move(*machine))
+			               .create();
+			if(!jit)
+			{
+				error("{0}", llvm::toString(jit.takeError()));
+				return nullptr;
+			}
+
+			auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+			    (*jit)->getDataLayout().getGlobalPrefix());
+			if(process)
+				(*jit)->getMainJITDylib().addGenerator(std::move(*process));
+			else
+				llvm::consumeError(process.takeError());
+
+			return std::move(*jit);
+		}
+	} // namespace
+
+	int runRepl(std::istream &in, std::ostream &out)
+	{
+		auto jit = createJIT();
+		if(jit == nullptr)
+			return 1;
+
+		Session     session(std::move(jit));
+		std::string input, line;
+		int         depth = 0;
+		bool        showTime = false;
+
+		out << "noct> " << std::flush;
+		while(std::getline(in, line))
+		{
+			if(input.empty() && line == ":q")
+				break;
+
+			if(input.empty() && line == ":time")
+			{
+				showTime = !showTime;
+				out << "noct> " << std::flush;
+				continue;
+			}
+
+			// Keep reading until every block that was opened is closed again.
+			input += line + "\n";
+			for(char c : line) depth += (c == '{') - (c == '}');
+			if(depth > 0)
+			{
+				out << "  ... " << std::flush;
+				continue;
+			}
+
+			auto begin = std::chrono::steady_clock::now();
+			session.run(input, out);
+			if(showTime)
+				out << std::chrono::duration<double, std::milli>(
+				           std::chrono::steady_clock::now() - begin)
+				           .count()
+				    << " ms" << std::endl;
+
+			input.clear();
+			depth = 0;
+			out << "noct> " << std::flush;
+		}
+
+		out << std::endl;
+		return 0;
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <iostream>
+
+namespace noct
+{
+	// Reads definitions and expressions from `in` until EOF or `:q`. Every top-level
+	// item becomes its own small module in one long-lived JIT session; expressions are
+	// compiled into a wrapper function, run and printed to `out`.
+	int runRepl(std::istream &in, std::ostream &out);
+}
@@ -0,0 +1,337 @@
+// Work-stealing runtime for `parallel for` and `parallel reduce` in noct code.
+//
+// The compiler outlines the body of a parallel loop into a function that runs a
+// range of iterations, and hands it to __noct_parallel_for or __noct_parallel_reduce.
+// A pool of NOCT_THREADS threads, one per hardware thread by default, shares the
+// range out: each thread halves the range it holds down to a grain, pushing the
+// halves it does not keep onto its own deque, and an idle thread steals the oldest,
+// largest range from another. The grain is measured rather than guessed: the caller
+// first runs a few iterations alone, timing them, and then picks the number of
+// iterations that takes a few microseconds, enough to pay for a steal.
+//
+// The calling thread works as one of the pool's threads until its loop is done.
+// Loops nest: a thread waiting for one runs whatever work it finds meanwhile.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Signatures shared with ASTParallelImpl in codegen.cpp.
+	using Body = void (*)(void *ctx, std::int64_t begin, std::int64_t end, void *acc);
+	using Combine = void (*)(void *acc, void *other);
+
+	// A leaf is cut to take about this long, and the probe runs for about half of it.
+	constexpr auto taskTime = std::chrono::nanoseconds(4000);
+	constexpr auto probeTime = std::chrono::nanoseconds(2000);
+
+	// Each thread gets enough leaves that one running long leaves the others some.
+	constexpr std::int64_t tasksPerThread = 8;
+
+	struct Job
+	{
+		Body        body;
+		Combine     combine; // null for a plain loop
+		void       *ctx;
+		std::size_t size = 0;   // of a result
+		std::size_t stride = 0; // between results, a cache line or more
+		std::int64_t grain = 1;
+		std::atomic<std::int64_t> remaining{0}; // iterations not run yet
+
+		// Two results per thread, a cache line apart: what it has combined so far,
+		// and what a leaf stores before that.
+		unsigned char *results = nullptr;
+
+		auto partial(std::size_t worker) -> unsigned char *
+		{
+			return results + 2 * worker * stride;
+		}
+	};
+
+	struct Task
+	{
+		Job         *job;
+		std::int64_t begin, end;
+	};
+
+	// The owner works at the back of its deque, thieves take from the front.
+	struct alignas(64) Worker
+	{
+		std::size_t      index = 0;
+		std::mutex       lock;
+		std::deque<Task> tasks;
+		std::uint64_t    seed = 0; // for picking a victim
+
+		void push(const Task &t)
+		{
+			std::lock_guard guard(lock);
+			tasks.push_back(t);
+		}
+
+		auto pop(Task &t) -> bool
+		{
+			std::lock_guard guard(lock);
+			if(tasks.empty())
+				return false;
+			t = tasks.back();
+			tasks.pop_back();
+			return true;
+		}
+
+		auto steal(Task &t) -> bool
+		{
+			std::unique_lock guard(lock, std::try_to_lock);
+			if(!guard.owns_lock() || tasks.empty())
+				return false;
+			t = tasks.front();
+			tasks.pop_front();
+			return true;
+		}
+	};
+
+	thread_local Worker *self = nullptr;
+
+	class Pool
+	{
+	public:
+		Pool()
+		{
+			std::size_t count = std::max(1u, std::thread::hardware_concurrency());
+			if(const char *n = std::getenv("NOCT_THREADS"); n != nullptr && std::atoi(n) > 0)
+				count = std::atoi(n);
+
+			for(std::size_t i = 0; i < count; ++i)
+			{
+				workers.push_back(std::make_unique<Worker>());
+				workers.back()->index = i;
+				workers.back()->seed = i * 0x9E3779B97F4A7C15 + 1;
+			}
+
+			// Worker 0 is whoever calls in from outside.
+			for(std::size_t i = 1; i < count; ++i)
+				threads.emplace_back([this, i] { loop(*workers[i]); });
+		}
+
+		~Pool()
+		{
+			{
+				std::lock_guard guard(sleepLock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for(auto &t : threads) t.join();
+		}
+
+		auto size() const -> std::size_t
+		{
+			return workers.size();
+		}
+
+		void run(Job &job, std::int64_t begin, std::int64_t end);
+
+	private:
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::vector<std::thread>             threads;
+
+		// One thread from outside the pool at a time; any other runs its loop alone.
+		std::mutex caller;
+
+		// Threads with nothing to do sleep until the generation changes, which every
+		// push does. Both sides go through sequentially consistent atomics, so either
+		// the sleeper sees the new generation or the pusher sees the sleeper.
+		std::mutex                 sleepLock;
+		std::condition_variable    wake;
+		std::atomic<std::uint64_t> generation{0};
+		std::atomic<std::size_t>   sleeping{0};
+		bool                       stopping = false;
+
+		void push(Worker &w, const Task &t)
+		{
+			w.push(t);
+			generation.fetch_add(1);
+			if(sleeping.load() != 0)
+			{
+				std::lock_guard guard(sleepLock);
+				wake.notify_all();
+			}
+		}
+
+		auto find(Worker &w, Task &t) -> bool
+		{
+			if(w.pop(t))
+				return true;
+
+			w.seed ^= w.seed << 13, w.seed ^= w.seed >> 7, w.seed ^= w.seed << 17;
+			auto start = w.seed % workers.size();
+			for(std::size_t i = 0; i < workers.size(); ++i)
+			{
+				auto &victim = *workers[(start + i) % workers.size()];
+				if(&victim != &w && victim.steal(t))
+					return true;
+			}
+			return false;
+		}
+
+		void execute(Worker &w, Task t)
+		{
+			auto &job = *t.job;
+			while(t.end - t.begin > job.grain)
+			{
+				auto middle = t.begin + (t.end - t.begin) / 2;
+				push(w, {t.job, middle, t.end});
+				t.end = middle;
+			}
+
+			if(job.combine == nullptr)
+				job.body(job.ctx, t.begin, t.end, nullptr);
+			else
+			{
+				auto *partial = job.partial(w.index);
+				job.body(job.ctx, t.begin, t.end, partial + job.stride);
+				job.combine(partial, partial + job.stride);
+			}
+
+			// Released only now, so that whoever sees the job done sees the results.
+			job.remaining.fetch_sub(t.end - t.begin, std::memory_order_release);
+		}
+
+		void loop(Worker &w)
+		{
+			self = &w;
+			Task t;
+			for(;;)
+			{
+				auto seen = generation.load();
+				if(find(w, t))
+				{
+					execute(w, t);
+					continue;
+				}
+
+				std::unique_lock guard(sleepLock);
+				sleeping.fetch_add(1);
+				wake.wait(guard, [&] { return stopping || generation.load() != seen; });
+				sleeping.fetch_sub(1);
+				if(stopping)
+					return;
+			}
+		}
+
+		// Runs from `begin` on the caller, one iteration and then twice as many each
+		// round, until they take long enough to time. Returns the grain.
+		auto probe(Job &job, Worker &w, std::int64_t &begin, std::int64_t end) -> std::int64_t
+		{
+			using Clock = std::chrono::steady_clock;
+			auto         start = Clock::now();
+			auto         elapsed = Clock::duration::zero();
+			std::int64_t done = 0;
+			for(std::int64_t n = 1; begin < end && elapsed < probeTime; n *= 2)
+			{
+				auto stop = begin + std::min(n, end - begin);
+				execute(w, {&job, begin, stop});
+				done += stop - begin;
+				begin = stop;
+				elapsed = Clock::now() - start;
+			}
+
+			auto perIteration = std::max<std::int64_t>(
+			    1, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / done);
+			auto spread = (end - begin) / (tasksPerThread * std::int64_t(workers.size()));
+			return std::max<std::int64_t>({taskTime.count() / perIteration, spread, 1});
+		}
+	};
+
+	void Pool::run(Job &job, std::int64_t begin, std::int64_t end)
+	{
+		std::unique_lock<std::mutex> outside;
+		auto                        *w = self;
+		if(w == nullptr)
+		{
+			outside = std::unique_lock(caller, std::try_to_lock);
+			if(!outside.owns_lock())
+			{
+				job.grain = end - begin;
+				job.remaining = end - begin;
+				execute(*workers[0], {&job, begin, end}); // its results are this job's own
+				return;
+			}
+			w = self = workers[0].get();
+		}
+
+		job.remaining = end - begin;
+		job.grain = end - begin;
+		if(workers.size() > 1)
+			job.grain = probe(job, *w, begin, end);
+
+		if(begin < end)
+		{
+			execute(*w, {&job, begin, end});
+
+			// Whatever is found meanwhile is run, for this loop or another.
+			Task t;
+			while(job.remaining.load(std::memory_order_acquire) != 0)
+				if(find(*w, t))
+					execute(*w, t);
+				else
+					std::this_thread::yield();
+		}
+
+		if(outside.owns_lock())
+			self = nullptr;
+	}
+
+	auto getPool() -> Pool &
+	{
+		static Pool pool;
+		return pool;
+	}
+}
+
+extern "C" void __noct_parallel_for(Body body, void *ctx, std::int64_t begin, std::int64_t end)
+{
+	if(begin >= end)
+		return;
+
+	Job job;
+	job.body = body;
+	job.combine = nullptr;
+	job.ctx = ctx;
+	getPool().run(job, begin, end);
+}
+
+// `result` holds the identity of the operator on entry, and the reduction on return.
+extern "C" void __noct_parallel_reduce(Body body, Combine combine, void *ctx,
+                                       std::int64_t begin, std::int64_t end, void *result,
+                                       std::uint64_t size)
+{
+	if(begin >= end)
+		return;
+
+	auto &pool = getPool();
+	Job   job;
+	job.body = body;
+	job.combine = combine;
+	job.ctx = ctx;
+	job.size = size;
+	job.stride = (size + 63) / 64 * 64;
+
+	auto bytes = 2 * pool.size() * job.stride;
+	job.results = static_cast<unsigned char *>(::operator new(bytes, std::align_val_t(64)));
+	for(std::size_t i = 0; i < pool.size(); ++i) std::memcpy(job.partial(i), result, size);
+
+	pool.run(job, begin, end);
+
+	for(std::size_t i = 0; i < pool.size(); ++i) combine(result, job.partial(i));
+	::operator delete(job.results, std::align_val_t(64));
+}
@@ -0,0 +1,182 @@
+// Function profiling runtime for code built with noct -finstrument-functions.
+//
+// Every instrumented function calls __noct_prof_enter/__noct_prof_exit with its
+// site record. Counters live in per-thread buffers, so the hot path takes no locks
+// and touches no shared cache lines; buffers are merged when a thread exits and the
+// report is printed at process exit, to stderr or to the file named by NOCT_PROFILE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace
+{
+	// Layout shared with instrumentFunction() in codegen.cpp.
+	struct Site
+	{
+		const char   *name;
+		std::uint64_t slot; // 0 until the site is registered, index + 1 after
+	};
+
+	struct Counters
+	{
+		std::uint64_t calls = 0;
+		std::uint64_t inclusive = 0;
+		std::uint64_t exclusive = 0;
+		std::uint32_t active = 0; // recursion depth, so inclusive is not counted twice
+	};
+
+	struct Frame
+	{
+		std::uint64_t slot;
+		std::uint64_t start;
+		std::uint64_t children;
+	};
+
+	inline auto cycles() -> std::uint64_t
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(__aarch64__)
+		std::uint64_t v;
+		asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+		return v;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	struct Registry
+	{
+		std::mutex                lock;
+		std::vector<const char *> names;
+		std::vector<Counters>     totals;
+
+		~Registry();
+
+		auto add(Site *site) -> std::uint64_t
+		{
+			std::lock_guard guard(lock);
+
+			std::atomic_ref slot(site->slot);
+			if(auto s = slot.load(std::memory_order_acquire); s != 0)
+				return s;
+
+			names.push_back(site->name);
+			slot.store(names.size(), std::memory_order_release);
+			return names.size();
+		}
+
+		void merge(const std::vector<Counters> &counters)
+		{
+			std::lock_guard guard(lock);
+			if(totals.size() < counters.size())
+				totals.resize(counters.size());
+
+			for(std::size_t i = 0; i < counters.size(); ++i)
+			{
+				totals[i].calls += counters[i].calls;
+				totals[i].inclusive += counters[i].inclusive;
+				totals[i].exclusive += counters[i].exclusive;
+			}
+		}
+	};
+
+	Registry registry;
+
+	struct ThreadBuffer
+	{
+		std::vector<Counters> counters;
+		std::vector<Frame>    stack;
+
+		ThreadBuffer()
+		{
+			stack.reserve(64);
+		}
+
+		~ThreadBuffer()
+		{
+			registry.merge(counters);
+		}
+	};
+
+	thread_local ThreadBuffer buffer;
+
+	Registry::~Registry()
+	{
+		// The main thread's buffer has been merged by now: thread_local destructors
+		// run before static ones.
+		std::vector<std::size_t> order;
+		for(std::size_t i = 0; i < totals.size(); ++i)
+			if(totals[i].calls != 0)
+				order.push_back(i);
+
+		std::sort(order.begin(), order.end(), [&](auto a, auto b) {
+			return totals[a].exclusive > totals[b].exclusive;
+		});
+
+		FILE *out = stderr;
+		if(const char *path = std::getenv("NOCT_PROFILE"); path != nullptr)
+			if(FILE *f = std::fopen(path, "w"); f != nullptr)
+				out = f;
+
+		std::fprintf(out, "%-32s %12s %16s %16s %12s\n", "function", "calls",
+		             "inclusive cyc", "exclusive cyc", "excl/call");
+		for(auto i : order)
+		{
+			const auto &c = totals[i];
+			std::fprintf(out, "%-32s %12llu %16llu %16llu %12.1f\n", names[i],
+			             (unsigned long long)c.calls, (unsigned long long)c.inclusive,
+			             (unsigned long long)c.exclusive, (double)c.exclusive / c.calls);
+		}
+
+		if(out != stderr)
+			std::fclose(out);
+	}
+}
+
+extern "C" void __noct_prof_enter(Site *site)
+{
+	auto slot = std::atomic_ref(site->slot).load(std::memory_order_acquire);
+	if(slot == 0)
+		slot = registry.add(site);
+
+	auto &b = buffer;
+	if(b.counters.size() < slot)
+		b.counters.resize(slot + 16);
+
+	++b.counters[slot - 1].active;
+	b.stack.push_back({slot, cycles(), 0});
+}
+
+extern "C" void __noct_prof_exit(Site *site)
+{
+	auto  end = cycles();
+	auto &b = buffer;
+	if(b.stack.empty())
+		return;
+
+	auto frame = b.stack.back();
+	b.stack.pop_back();
+
+	auto  elapsed = end - frame.start;
+	auto &c = b.counters[frame.slot - 1];
+	++c.calls;
+	c.exclusive += elapsed - std::min(elapsed, frame.children);
+	if(--c.active == 0)
+		c.inclusive += elapsed;
+
+	if(!b.stack.empty())
+		b.stack.back().children += elapsed;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Malformed input has to be rejected, quickly and without crashing: truncated and
+# shuffled programs, random bytes, and nesting far deeper than any real program.
+
+mkdir -p bin/fuzz
+rm -f bin/fuzz/*.noct
+
+./noct-bench -f 2000 -g 200 -x 4 --emit > bin/fuzz/valid.noct || exit 1
+
+size=$(wc -c < bin/fuzz/valid.noct)
+for cut in 1 7 100 4099 $((size / 3)) $((size / 2)) $((size - 2)); do
+	head -c $cut bin/fuzz/valid.noct > bin/fuzz/truncated-$cut.noct
+done
+
+tr -s ' \n\t' '\n' < bin/fuzz/valid.noct | shuf --random-source=bin/fuzz/valid.noct \
+	> bin/fuzz/shuffled.noct
+head -c 1000000 /dev/urandom > bin/fuzz/random.noct
+
+deep() { printf 'fn main -> i32 '; yes "$1" | head -n 1000000 | tr -d '\n'; }
+deep '{' > bin/fuzz/braces.noct
+deep '(' > bin/fuzz/parens.noct
+deep '-' > bin/fuzz/negations.noct
+deep 'if 1 ' > bin/fuzz/ifs.noct
+yes 'pub ' | head -n 1000000 | tr -d '\n' > bin/fuzz/pubs.noct
+
+# Chains build trees as deep as nesting does, without the parser recursing.
+chain() { printf 'fn main -> i32 { %s' "$1"; yes "$2" | head -n 50000 | tr -d '\n'; }
+chain '1' ' + 1' > bin/fuzz/sums.noct
+chain 'if 1 { 1 }' ' else if 1 { 1 }' > bin/fuzz/else-ifs.noct
+chain 'main()' '[0]' > bin/fuzz/indices.noct
+yes 'fn } let ; @ ( ' | head -n 200000 | tr -d '\n' > bin/fuzz/keywords.noct
+
+status=0
+for f in bin/fuzz/*.noct; do
+	[ "$f" = bin/fuzz/valid.noct ] && continue
+	timeout 10 ./noct "$f" bin/fuzz/out.o > /dev/null 2>&1
+	code=$?
+	# 1 is a rejected program, and a cut can land between two items. Timeouts
+	# and signals are failures.
+	if [ $code -gt 1 ]; then
+		echo "$f: exit status $code"
+		status=1
+	fi
+done
+exit $status
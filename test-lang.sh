@@ -0,0 +1,107 @@
+#!/bin/sh
+# Language rules that show in what a program computes. Each case is linked into an
+# executable and has to exit with the status it names, or has to be rejected.
+
+mkdir -p bin/lang
+status=0
+count=0
+
+# expect <status> <program>: the program builds, and main returns the status.
+expect() {
+	count=$((count + 1))
+	printf '%s\n' "$2" > bin/lang/$count.noct
+	if ! ./noct bin/lang/$count.noct bin/lang/$count > /dev/null 2>&1; then
+		echo "case $count: rejected: $2"
+		status=1
+		return
+	fi
+	bin/lang/$count
+	code=$?
+	if [ $code -ne $1 ]; then
+		echo "case $count: exit status $code, expected $1: $2"
+		status=1
+	fi
+}
+
+# reject <program>: noct refuses it with status 1.
+reject() {
+	count=$((count + 1))
+	printf '%s\n' "$1" > bin/lang/$count.noct
+	./noct bin/lang/$count.noct bin/lang/$count > /dev/null 2>&1
+	code=$?
+	if [ $code -ne 1 ]; then
+		echo "case $count: exit status $code, expected a rejection: $1"
+		status=1
+	fi
+}
+
+# session <output> <lines>: the REPL, fed the lines, prints the output, prompts and
+# diagnostics aside.
+session() {
+	count=$((count + 1))
+	out=$(printf '%s\n' "$2" | ./noct --repl 2> /dev/null | sed 's/noct> //g' | grep -v '^$')
+	if [ "$out" != "$1" ]; then
+		echo "session $count: printed '$out', expected '$1'"
+		status=1
+	fi
+}
+
+# A bare literal takes the type it is stored to when it holds the value.
+expect 5 'fn main -> i32 { let b: u8 = 0; b = 5; b }'
+expect 251 'fn main -> i32 { let c: i8 = -5; c }'
+expect 0 'fn main -> i32 { let i: i8 = 0; i }'
+expect 128 'fn main -> i32 { let i: i8 = -128; i }'
+expect 255 'let b: u8 = 255;
+fn main -> i32 { b }'
+expect 201 'fn f(x: u8, y: i8) -> i32 { x + y }
+fn main -> i32 { f(200, 1) }'
+reject 'fn main -> i32 { let b: u8 = 256; b }'
+reject 'fn main -> i32 { let b: u8 = -1; b }'
+reject 'fn main -> i32 { let c: i8 = -129; c }'
+reject 'fn f(x: u8) -> i32 { x }
+fn main -> i32 { f(300) }'
+
+# A shifted literal stands for the literal it makes. A constant shift by the
+# width or more is rejected, by the typechecker or when it is folded.
+expect 7 'fn main -> i32 { let d: i64 = 1 << 40; if d == 1099511627776 { 7 } else { 1 } }'
+expect 7 'let d: i64 = 1 << 40;
+fn main -> i32 { if d == 1099511627776 { 7 } else { 1 } }'
+expect 7 'fn main -> i32 { let d: u64 = 1 << 63; if d >> 63 == 1 { 7 } else { 1 } }'
+reject 'fn main -> i32 { let x: i32 = 1 << 40; x }'
+reject 'fn main -> i32 { let x: i32 = 1; x << 32 }'
+reject 'let k: i32 = 70;
+let d: i64 = 1i64 << k;
+fn main -> i32 { 0 }'
+reject '@comptime fn shift(n: i32) -> i32 { 1 << n }
+fn main -> i32 { shift(40) }'
+
+# Float initializers fold like integer ones, rounded to f32 where they are f32.
+expect 7 'let a: f64 = -1.5;
+fn main -> i32 { if a < 0.0 { 7 } else { 1 } }'
+expect 7 'let a: f64 = 1.5 * 2.0;
+fn main -> i32 { if a == 3.0 { 7 } else { 1 } }'
+expect 7 'let a: f64 = (10.0 - 4.0) / 4.0 + 1.0;
+let b: i32 = if a > 2.0 { 7 } else { 1 };
+fn main -> i32 { b }'
+expect 7 'let a: f32 = 1.0f32 / 3.0;
+fn third(x: f32) -> f32 { x / 3.0 }
+fn main -> i32 { if a == third(1.0) { 7 } else { 1 } }'
+
+# In the REPL a global initializer sees what earlier lines left in other globals.
+session 'i32 0
+i32 11' 'let x: i32 = 5;
+fn setx -> i32 { x = 10; 0 }
+setx()
+let y: i32 = x + 1;
+y'
+
+# A REPL line is parsed whole before any of it runs; an assignment is a statement.
+session 'i32 7
+i32 7' 'let x: i32 = 5;
+x = 7;
+x'
+session 'i32 5' 'let x: i32 = 5;
+x = 8; x +;
+x'
+
+exit $status
@@ -0,0 +1,30 @@
+#!/bin/sh
+# ThinLTO across noct and C: main() in C calls kernel() from a noct module. After
+# the link the call must be inlined and the unused noct global must be gone. A
+# kernel whose own call survives, at -O0 and -O2, gives the summary call edges.
+
+mkdir -p bin
+
+printf 'int kernel(void);\nint main(void) { return kernel() != 12345; }\n' \
+	> bin/lto-main.c
+printf 'int kernel(int);\nint main(int argc, char **argv) { return kernel(argc + 4113) != 12345; }\n' \
+	> bin/lto-calls-main.c
+printf '@noinline fn triple(x: i32) -> i32 { x * 3 }\npub fn kernel(n: i32) -> i32 { triple(n) + 3 }\n' \
+	> bin/lto-calls.noct
+
+./noct -O2 -flto=thin bench/kernels/globals.noct bin/lto-kernel.o \
+&& clang -O2 -flto=thin -c bin/lto-main.c -o bin/lto-main.o \
+&& clang -O2 -flto=thin -fuse-ld=lld bin/lto-main.o bin/lto-kernel.o -o bin/lto \
+&& bin/lto \
+&& ! llvm-objdump -d --disassemble-symbols=main bin/lto | grep -q 'call.*kernel' \
+&& ! llvm-nm bin/lto | grep -q ' scale$' \
+|| exit 1
+
+for level in 0 2; do
+	./noct -O$level -flto=thin bin/lto-calls.noct bin/lto-calls.o \
+	&& test -s bin/lto-calls.o \
+	&& clang -O$level -flto=thin -c bin/lto-calls-main.c -o bin/lto-calls-main.o \
+	&& clang -O$level -flto=thin -fuse-ld=lld bin/lto-calls-main.o bin/lto-calls.o -o bin/lto-calls \
+	&& bin/lto-calls \
+	|| exit 1
+done
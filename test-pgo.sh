@@ -0,0 +1,22 @@
+#!/bin/sh
+# PGO round trip on a kernel with branches: instrument, run, merge, rebuild with the
+# profile and check that the counts made it into the optimized module as entry
+# counts and branch weights. A profile that is not there must fail the build.
+
+mkdir -p bin
+rm -f bin/pgo-*.profraw bin/pgo-missing.o
+
+./noct -O2 -fprofile-instr-generate=bin/pgo-%p.profraw bench/kernels/branches.noct \
+       bin/pgo-gen.o \
+&& clang -fprofile-instr-generate bench/kernels/driver.c bin/pgo-gen.o -o bin/pgo-gen \
+&& bin/pgo-gen \
+&& llvm-profdata merge bin/pgo-*.profraw -o bin/pgo.profdata \
+&& ./noct -O2 -fprofile-instr-use=bin/pgo.profdata bench/kernels/branches.noct \
+          bin/pgo-use.o \
+&& grep -q function_entry_count bin/pgo-use.o.ll \
+&& grep -q '!prof' bin/pgo-use.o.ll \
+&& clang bench/kernels/driver.c bin/pgo-use.o -o bin/pgo-use \
+&& bin/pgo-use \
+&& ! ./noct -O2 -fprofile-instr-use=bin/pgo-missing.profdata bench/kernels/branches.noct \
+            bin/pgo-missing.o \
+&& test ! -e bin/pgo-missing.o
@@ -2,6 +2,5 @@
 
 mkdir -p bin
 
-./noct example.noct bin/$1.o \
-&& clang bin/$1.o -o bin/$1  \
+./noct example.noct -o bin/$1 \
 && bin/$1
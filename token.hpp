@@ -31,12 +31,28 @@ namespace noct
 		opr_gteql, // >=
 		opr_shftr, // >>
 		opr_shftl, // <<
+		opr_wradd, // +%
+		opr_wrsub, // -%
+		opr_wrmul, // *%
+		opr_chadd, // +?
+		opr_chsub, // -?
+		opr_chmul, // *?
+		opr_range, // ..
 		kwd_fn,
 		kwd_if,
 		kwd_let,
 		kwd_else,
+		kwd_pub,
+		kwd_while,
+		kwd_restrict,
+		kwd_readonly,
+		kwd_struct,
+		kwd_parallel,
 	};
 
+	// Token types are below the first printable character.
+	static_assert(TokenType::kwd_parallel < ' ');
+
 	constexpr auto tokenTypeToString(TokenType t) -> const char *
 	{
 		switch(t)
@@ -71,6 +87,20 @@ namespace noct
 			return "opr_shftr";
 		case TokenType::opr_shftl:
 			return "opr_shftl";
+		case TokenType::opr_wradd:
+			return "opr_wradd";
+		case TokenType::opr_wrsub:
+			return "opr_wrsub";
+		case TokenType::opr_wrmul:
+			return "opr_wrmul";
+		case TokenType::opr_chadd:
+			return "opr_chadd";
+		case TokenType::opr_chsub:
+			return "opr_chsub";
+		case TokenType::opr_chmul:
+			return "opr_chmul";
+		case TokenType::opr_range:
+			return "opr_range";
 		case TokenType::kwd_fn:
 			return "kwd_fn";
 		case TokenType::kwd_if:
@@ -79,6 +109,18 @@ namespace noct
 			return "kwd_let";
 		case TokenType::kwd_else:
 			return "kwd_else";
+		case TokenType::kwd_pub:
+			return "kwd_pub";
+		case TokenType::kwd_while:
+			return "kwd_while";
+		case TokenType::kwd_restrict:
+			return "kwd_restrict";
+		case TokenType::kwd_readonly:
+			return "kwd_readonly";
+		case TokenType::kwd_struct:
+			return "kwd_struct";
+		case TokenType::kwd_parallel:
+			return "kwd_parallel";
 		default:
 			return "?";
 		}
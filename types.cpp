@@ -1,6 +1,8 @@
 #include "types.hpp"
 
 #include <iostream>
+#include <numeric>
+#include <utility>
 
 namespace noct
 {
@@ -37,9 +39,427 @@ namespace noct
 		return false;
 	}
 
+	namespace
+	{
+		void printQualifiers(std::ostream &out, const PointerQualifiers &q)
+		{
+			if(q.restrict)
+				out << "restrict ";
+			if(q.readonly)
+				out << "readonly ";
+		}
+	} // namespace
+
 	void TypePointer::print(std::ostream &out) const noexcept
 	{
+		printQualifiers(out, qualifiers);
 		base->print(out);
 		out << "*";
 	}
+
+	std::size_t TypeVector::size() const noexcept
+	{
+		return getNumericTypeWidth(element) * lanes;
+	}
+
+	// A scalar is broadcast to every lane.
+	bool TypeVector::assignable(Ptr<Type> out) const noexcept
+	{
+		if(auto t = dynamic_cast<TypeVector *>(out.get()); t != nullptr)
+			return t->element == element && t->lanes == lanes;
+
+		return TypeNumeric(element).assignable(out);
+	}
+
+	void TypeVector::print(std::ostream &out) const noexcept
+	{
+		out << getNumericTypeName(element) << "x" << lanes;
+	}
+
+	std::size_t TypeArray::size() const noexcept
+	{
+		// The arrays of an @soa array leave out the padding of the struct.
+		std::size_t each = element->size();
+		if(auto s = dynamic_cast<TypeStruct *>(element.get()); s != nullptr && soa)
+			for(each = 0; const auto &f : s->fields) each += f.type->size();
+		return each * count;
+	}
+
+	bool TypeArray::assignable(Ptr<Type>) const noexcept
+	{
+		return false;
+	}
+
+	void TypeArray::print(std::ostream &out) const noexcept
+	{
+		out << (soa ? "@soa " : "");
+		element->print(out);
+		out << "[" << count << "]";
+	}
+
+	std::size_t TypeSlice::size() const noexcept
+	{
+		return getNumericTypeWidth(platformPointerType) * 2;
+	}
+
+	bool TypeSlice::assignable(Ptr<Type> out) const noexcept
+	{
+		// Dropping `readonly` would allow writes that the source promised not to make.
+		if(auto t = dynamic_cast<TypeSlice *>(out.get()); t != nullptr)
+			return isSameType(element, t->element) && soa == t->soa
+			    && (qualifiers.readonly || !t->qualifiers.readonly);
+		if(auto t = dynamic_cast<TypeArray *>(out.get()); t != nullptr)
+			return isSameType(element, t->element) && soa == t->soa;
+
+		return false;
+	}
+
+	void TypeSlice::print(std::ostream &out) const noexcept
+	{
+		printQualifiers(out, qualifiers);
+		out << (soa ? "@soa " : "");
+		element->print(out);
+		out << "[]";
+	}
+
+	auto isSameType(const Ptr<Type> &a, const Ptr<Type> &b) -> bool
+	{
+		if(a == nullptr || b == nullptr || a->type != b->type)
+			return false;
+
+		// Structs are the same by name only, and each name is declared once.
+		if(dynamic_cast<TypeStruct *>(a.get()) != nullptr)
+			return a == b;
+
+		if(auto x = dynamic_cast<TypeNumeric *>(a.get()); x != nullptr)
+		{
+			auto y = dynamic_cast<TypeNumeric *>(b.get());
+			return y != nullptr && x->numeric == y->numeric;
+		}
+		if(auto x = dynamic_cast<TypeVector *>(a.get()); x != nullptr)
+		{
+			auto y = static_cast<TypeVector *>(b.get());
+			return x->element == y->element && x->lanes == y->lanes;
+		}
+		if(auto x = dynamic_cast<TypeArray *>(a.get()); x != nullptr)
+		{
+			auto y = dynamic_cast<TypeArray *>(b.get());
+			return y != nullptr && x->count == y->count && x->soa == y->soa
+			    && isSameType(x->element, y->element);
+		}
+		if(auto x = dynamic_cast<TypeSlice *>(a.get()); x != nullptr)
+		{
+			auto y = dynamic_cast<TypeSlice *>(b.get());
+			return y != nullptr && x->soa == y->soa && isSameType(x->element, y->element);
+		}
+		return a->type == TypeType::unit;
+	}
+
+	void TypeStruct::layOut()
+	{
+		std::vector<std::size_t> order(fields.size());
+		std::iota(order.begin(), order.end(), 0);
+		auto natural = [&](std::size_t i) { return getTypeAlignment(fields[i].type); };
+		auto byAlignment = [&](std::size_t a, std::size_t b) { return natural(a) > natural(b); };
+
+		// Alignments are powers of two, so in decreasing order every field ends
+		// where the next one may start.
+		if(!reprC)
+			std::stable_sort(order.begin(), order.end(), byAlignment);
+
+		bytes = 0;
+		alignment = 1;
+		for(std::size_t i = 0; i < order.size(); ++i)
+		{
+			auto &f = fields[order[i]];
+			auto  a = packed ? 1 : natural(order[i]);
+			bytes = (bytes + a - 1) / a * a;
+			f.offset = bytes;
+			f.position = i;
+			bytes += f.type->size();
+			alignment = std::max(alignment, a);
+		}
+		alignment = std::max(alignment, minAlignment);
+		bytes = (bytes + alignment - 1) / alignment * alignment;
+
+		// The arrays of an @soa array go by decreasing alignment too, whatever the
+		// struct itself says: each then starts aligned for its elements.
+		if(reprC)
+			std::stable_sort(order.begin(), order.end(), byAlignment);
+		std::uint64_t soaOffset = 0;
+		for(auto i : order)
+		{
+			fields[i].soaOffset = soaOffset;
+			soaOffset += fields[i].type->size();
+		}
+	}
+
+	auto TypeStruct::getField(std::string_view name) const -> std::optional<std::size_t>
+	{
+		for(std::size_t i = 0; i < fields.size(); ++i)
+			if(fields[i].name == name)
+				return i;
+		return std::nullopt;
+	}
+
+	std::size_t TypeStruct::size() const noexcept
+	{
+		return bytes;
+	}
+
+	// Used a field at a time, like an array an element at a time.
+	bool TypeStruct::assignable(Ptr<Type>) const noexcept
+	{
+		return false;
+	}
+
+	void TypeStruct::print(std::ostream &out) const noexcept
+	{
+		out << name;
+	}
+
+	auto getTypeAlignment(const Ptr<Type> &t) -> std::uint64_t
+	{
+		if(auto s = dynamic_cast<TypeStruct *>(t.get()); s != nullptr)
+			return s->alignment;
+		if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr && a->soa)
+		{
+			std::uint64_t alignment = 1;
+			for(const auto &f : getStructElement(t)->fields)
+				alignment = std::max(alignment, getTypeAlignment(f.type));
+			return alignment;
+		}
+		if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr)
+			return getTypeAlignment(a->element);
+		return std::max<std::uint64_t>(t->size(), 1);
+	}
+
+	auto getStructElement(const Ptr<Type> &t) -> TypeStruct *
+	{
+		if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr)
+			return dynamic_cast<TypeStruct *>(a->element.get());
+		if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+			return dynamic_cast<TypeStruct *>(s->element.get());
+		return nullptr;
+	}
+
+	auto getPointerQualifiers(const Ptr<Type> &t) -> const PointerQualifiers *
+	{
+		if(auto p = dynamic_cast<TypePointer *>(t.get()); p != nullptr)
+			return &p->qualifiers;
+		if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+			return &s->qualifiers;
+		return nullptr;
+	}
+
+	auto getVectorTypeByName(std::string_view name) -> Ptr<TypeVector>
+	{
+		auto x = name.find('x');
+		if(x == std::string_view::npos)
+			return nullptr;
+
+		auto element = getNumericTypeByName(name.substr(0, x));
+		auto count = name.substr(x + 1);
+		if(element == NumericType::unknown || count.empty() || count.size() > 2
+		   || count[0] == '0')
+			return nullptr;
+
+		std::uint32_t lanes = 0;
+		for(char c : count)
+		{
+			if(c < '0' || c > '9')
+				return nullptr;
+			lanes = lanes * 10 + (c - '0');
+		}
+
+		if(lanes < 2 || lanes > 64 || (lanes & (lanes - 1)) != 0)
+			return nullptr;
+		return makePtr<TypeVector>(element, lanes);
+	}
+
+	std::size_t TypeUnit::size() const noexcept
+	{
+		return 0;
+	}
+
+	bool TypeUnit::assignable(Ptr<Type> out) const noexcept
+	{
+		return dynamic_cast<TypeUnit *>(out.get()) != nullptr;
+	}
+
+	void TypeUnit::print(std::ostream &out) const noexcept
+	{
+		out << "()";
+	}
+
+	namespace
+	{
+		constexpr std::pair<std::string_view, TypeConstraint> constraintNames[] = {
+			{ "numeric", TypeConstraint::numeric },
+			{ "integer", TypeConstraint::integer },
+			{ "float", TypeConstraint::floating },
+			{ "signed", TypeConstraint::signedNumeric },
+			{ "unsigned", TypeConstraint::unsignedInteger },
+		};
+	} // namespace
+
+	auto getTypeConstraintByName(std::string_view name) -> std::optional<TypeConstraint>
+	{
+		for(const auto &[n, c] : constraintNames)
+			if(name == n)
+				return c;
+		return std::nullopt;
+	}
+
+	auto getTypeConstraintName(TypeConstraint constraint) -> std::string_view
+	{
+		for(const auto &[n, c] : constraintNames)
+			if(constraint == c)
+				return n;
+		return "any";
+	}
+
+	auto satisfiesConstraint(const Ptr<Type> &t, TypeConstraint constraint) -> bool
+	{
+		if(constraint == TypeConstraint::any)
+			return true;
+
+		auto n = NumericType::unknown;
+		if(auto x = dynamic_cast<TypeNumeric *>(t.get()); x != nullptr)
+			n = x->numeric;
+		else if(auto v = dynamic_cast<TypeVector *>(t.get()); v != nullptr)
+			n = v->element;
+
+		switch(constraint)
+		{
+		case TypeConstraint::numeric:
+			return n != NumericType::unknown;
+		case TypeConstraint::integer:
+			return n != NumericType::unknown && !isFloatingNumericType(n);
+		case TypeConstraint::floating:
+			return isFloatingNumericType(n);
+		case TypeConstraint::signedNumeric:
+			return isSignedNumericType(n);
+		case TypeConstraint::unsignedInteger:
+			return n != NumericType::unknown && !isSignedNumericType(n);
+		default:
+			return true;
+		}
+	}
+
+	std::size_t TypeParameter::size() const noexcept
+	{
+		return 0;
+	}
+
+	bool TypeParameter::assignable(Ptr<Type> out) const noexcept
+	{
+		return out.get() == this;
+	}
+
+	void TypeParameter::print(std::ostream &out) const noexcept
+	{
+		out << name;
+	}
+
+	void bindTypeParameters(const Ptr<Type> &param, const Ptr<Type> &arg,
+	                        TypeBindings &bindings)
+	{
+		auto array = dynamic_cast<TypeArray *>(arg.get());
+		if(auto p = dynamic_cast<TypeParameter *>(param.get()); p != nullptr)
+		{
+			// An array goes in as a slice.
+			if(array != nullptr)
+			{
+				auto slice = makePtr<TypeSlice>(array->element);
+				slice->soa = array->soa;
+				bindings.try_emplace(p->name, slice);
+			}
+			else
+				bindings.try_emplace(p->name, arg);
+		}
+		else if(auto s = dynamic_cast<TypeSlice *>(param.get()); s != nullptr)
+		{
+			if(auto a = dynamic_cast<TypeSlice *>(arg.get()); a != nullptr)
+				bindTypeParameters(s->element, a->element, bindings);
+			else if(array != nullptr)
+				bindTypeParameters(s->element, array->element, bindings);
+		}
+		else if(auto p = dynamic_cast<TypePointer *>(param.get()); p != nullptr)
+		{
+			if(auto a = dynamic_cast<TypePointer *>(arg.get()); a != nullptr)
+				bindTypeParameters(p->base, a->base, bindings);
+		}
+	}
+
+	auto substituteTypeParameters(const Ptr<Type> &t, const TypeBindings &bindings)
+	    -> Ptr<Type>
+	{
+		auto element = [&](const Ptr<Type> &e) -> Ptr<Type> {
+			auto r = substituteTypeParameters(e, bindings);
+			if(r == nullptr
+			   || (r->type != TypeType::numeric && r->type != TypeType::vector
+			       && dynamic_cast<TypeStruct *>(r.get()) == nullptr))
+				return nullptr;
+			return r;
+		};
+
+		if(auto p = dynamic_cast<TypeParameter *>(t.get()); p != nullptr)
+		{
+			auto b = bindings.find(p->name);
+			return b != bindings.end() ? b->second : nullptr;
+		}
+		if(auto s = dynamic_cast<TypeSlice *>(t.get()); s != nullptr)
+		{
+			auto e = element(s->element);
+			if(e == nullptr)
+				return nullptr;
+			auto r = makePtr<TypeSlice>(e);
+			r->qualifiers = s->qualifiers;
+			r->soa = s->soa;
+			return r;
+		}
+		if(auto a = dynamic_cast<TypeArray *>(t.get()); a != nullptr)
+		{
+			auto e = element(a->element);
+			if(e == nullptr)
+				return nullptr;
+			auto r = makePtr<TypeArray>(e, a->count);
+			r->soa = a->soa;
+			return r;
+		}
+		if(auto p = dynamic_cast<TypePointer *>(t.get()); p != nullptr)
+		{
+			auto base = substituteTypeParameters(p->base, bindings);
+			if(base == nullptr)
+				return nullptr;
+			auto r = makePtr<TypePointer>(base);
+			r->qualifiers = p->qualifiers;
+			return r;
+		}
+		return t;
+	}
+
+	std::size_t TypeFunction::size() const noexcept
+	{
+		return getNumericTypeWidth(platformPointerType);
+	}
+
+	bool TypeFunction::assignable(Ptr<Type>) const noexcept
+	{
+		return false;
+	}
+
+	void TypeFunction::print(std::ostream &out) const noexcept
+	{
+		out << "fn(";
+		for(std::size_t i = 0; i < signature.argTypes.size(); ++i)
+		{
+			if(i != 0)
+				out << ", ";
+			signature.argTypes[i]->print(out);
+		}
+		out << ") -> ";
+		signature.returnType->print(out);
+	}
 } // namespace noct
@@ -4,6 +4,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <algorithm>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace noct
 {
@@ -11,6 +17,10 @@ namespace noct
 	{
 		numeric,
 		structural,
+		function,
+		vector,
+		unit,
+		parameter,
 		unknown
 	};
 
@@ -34,29 +44,31 @@ namespace noct
 
 	extern NumericType platformPointerType;
 
+	// Both classify by magnitude against fixed limits. (They used to recompute the
+	// limits with pow() for every comparison, and got 2^(n-1) and 2^64 wrong.)
 	template<Integral T>
 	constexpr auto getSmallestIntegerTypeFor(T val) -> NumericType
 	{
 		if(val >= 0)
 		{
-			if(val <= pow<std::size_t>(2, 8) / 2) return NumericType::i8 ;
-			if(val <= pow<std::size_t>(2, 8)) return NumericType::u8 ;
-			if(val <= pow<std::size_t>(2, 16) / 2) return NumericType::i16;
-			if(val <= pow<std::size_t>(2, 16)) return NumericType::u16;
-			if(val <= pow<std::size_t>(2, 32) / 2) return NumericType::i32;
-			if(val <= pow<std::size_t>(2, 32)) return NumericType::u32;
-			if(val <= pow<std::size_t>(2, 64) / 2) return NumericType::i64;
-			if(val <= pow<std::size_t>(2, 64)) return NumericType::u64;
+			auto v = std::uint64_t(val);
+			if(v <= 0x7F) return NumericType::i8 ;
+			if(v <= 0xFF) return NumericType::u8 ;
+			if(v <= 0x7FFF) return NumericType::i16;
+			if(v <= 0xFFFF) return NumericType::u16;
+			if(v <= 0x7FFFFFFF) return NumericType::i32;
+			if(v <= 0xFFFFFFFF) return NumericType::u32;
+			if(v <= 0x7FFFFFFFFFFFFFFF) return NumericType::i64;
+			return NumericType::u64;
 		}
 		else
 		{
-			val = -val;
-			if(val <= pow<std::size_t>(2, 8) / 2) return NumericType::i8 ;
-			if(val <= pow<std::size_t>(2, 16) / 2) return NumericType::i16;
-			if(val <= pow<std::size_t>(2, 32) / 2) return NumericType::i32;
-			if(val <= pow<std::size_t>(2, 64) / 2) return NumericType::i64;
+			auto v = std::int64_t(val);
+			if(v >= -0x80) return NumericType::i8 ;
+			if(v >= -0x8000) return NumericType::i16;
+			if(v >= -0x80000000ll) return NumericType::i32;
+			return NumericType::i64;
 		}
-		return NumericType::unknown;
 	}
 
 	template<Integral T>
@@ -64,18 +76,18 @@ namespace noct
 	{
 		if(val >= 0)
 		{
-			if(val <= pow<std::size_t>(2, 32) / 2) return NumericType::i32;
-			if(val <= pow<std::size_t>(2, 32)) return NumericType::u32;
-			if(val <= pow<std::size_t>(2, 64) / 2) return NumericType::i64;
-			if(val <= pow<std::size_t>(2, 64)) return NumericType::u64;
+			auto v = std::uint64_t(val);
+			if(v <= 0x7FFFFFFF) return NumericType::i32;
+			if(v <= 0xFFFFFFFF) return NumericType::u32;
+			if(v <= 0x7FFFFFFFFFFFFFFF) return NumericType::i64;
+			return NumericType::u64;
 		}
 		else
 		{
-			val = -val;
-			if(val <= pow<std::size_t>(2, 32) / 2) return NumericType::i32;
-			if(val <= pow<std::size_t>(2, 64) / 2) return NumericType::i64;
+			auto v = std::int64_t(val);
+			if(v >= -0x80000000ll) return NumericType::i32;
+			return NumericType::i64;
 		}
-		return NumericType::unknown;
 	}
 
 	constexpr auto isSignedNumericType(NumericType t) -> bool
@@ -107,6 +119,11 @@ namespace noct
 		}
 	}
 
+	constexpr auto isFloatingNumericType(NumericType t) -> bool
+	{
+		return t == NumericType::f32 || t == NumericType::f64;
+	}
+
 	constexpr auto getNumericTypeWidth(NumericType t) -> std::uint8_t
 	{
 		switch(t)
@@ -165,6 +182,34 @@ namespace noct
 		}
 	}
 
+	constexpr auto getNumericTypeByName(std::string_view name) -> NumericType
+	{
+		for(auto t : {NumericType::u8, NumericType::u16, NumericType::u32, NumericType::u64,
+		              NumericType::i8, NumericType::i16, NumericType::i32, NumericType::i64,
+		              NumericType::f32, NumericType::f64})
+			if(name == getNumericTypeName(t))
+				return t;
+		return NumericType::unknown;
+	}
+
+	// What both operands of an arithmetic operator are converted to: a floating
+	// type over an integer one, then the wider type, and the unsigned one of two
+	// equally wide integer types, as in C.
+	constexpr auto getCommonNumericType(NumericType a, NumericType b) -> NumericType
+	{
+		if(isFloatingNumericType(a) != isFloatingNumericType(b))
+			return isFloatingNumericType(a) ? a : b;
+		if(getNumericTypeWidth(a) != getNumericTypeWidth(b))
+			return getNumericTypeWidth(a) > getNumericTypeWidth(b) ? a : b;
+		return isSignedNumericType(a) ? b : a;
+	}
+
+	constexpr auto fitsNumericType(std::uint64_t value, NumericType t) -> bool
+	{
+		auto bits = getNumericTypeWidth(t) * 8 - isSignedNumericType(t);
+		return bits >= 64 || value < (std::uint64_t(1) << bits);
+	}
+
 	struct TypeNumeric : Type
 	{
 		NumericType numeric;
@@ -176,9 +221,19 @@ namespace noct
 		virtual void print(std::ostream &out) const noexcept override;
 	};
 
+	// Promises about the memory behind a pointer or a slice. `restrict`: while it
+	// is in use, nothing else reaches that memory. `readonly`: it is not written
+	// through.
+	struct PointerQualifiers
+	{
+		bool restrict = false;
+		bool readonly = false;
+	};
+
 	struct TypePointer : Type
 	{
 		Ptr<Type> base;
+		PointerQualifiers qualifiers;
 
 		TypePointer(Ptr<Type> base) : Type(TypeType::numeric), base(base) {}
 
@@ -187,9 +242,185 @@ namespace noct
 		virtual void print(std::ostream &out) const noexcept override;
 	};
 
+	// A fixed number of lanes of one numeric type, operated on all at once. The
+	// lane count is a power of two.
+	struct TypeVector : Type
+	{
+		NumericType element;
+		std::uint32_t lanes;
+
+		TypeVector(NumericType element, std::uint32_t lanes)
+			: Type(TypeType::vector), element(element), lanes(lanes) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	// A fixed number of elements in place: in a global, or on the stack of the
+	// function that declares it. It is used through slices and indexing only, so
+	// it cannot be assigned or passed around whole.
+	struct TypeArray : Type
+	{
+		Ptr<Type> element;
+		std::uint64_t count;
+		bool soa = false; // @soa: an array of structs kept as an array per field
+
+		TypeArray(Ptr<Type> element, std::uint64_t count)
+			: Type(TypeType::structural), element(std::move(element)), count(count) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	// A pointer to the first element and how many there are. Any array of the same
+	// element type converts to one.
+	struct TypeSlice : Type
+	{
+		Ptr<Type> element;
+		PointerQualifiers qualifiers;
+		bool soa = false; // of an @soa array
+
+		TypeSlice(Ptr<Type> element) : Type(TypeType::structural), element(std::move(element)) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	struct StructField
+	{
+		std::string   name;
+		Ptr<Type>     type;
+		std::uint64_t offset = 0;    // from the start of the struct
+		std::size_t   position = 0;  // among the fields, by offset
+		std::uint64_t soaOffset = 0; // in an @soa array of n, its array starts at n * soaOffset
+	};
+
+	// Named numbers and vectors, in place like an array: a variable, or an element
+	// of an array, used one field at a time. Unless it is @repr(C), the fields are
+	// laid out by decreasing alignment, which leaves no padding between them.
+	// @packed leaves none at all, and @align(N) aligns the whole to N bytes.
+	struct TypeStruct : Type
+	{
+		std::string name;
+		std::vector<StructField> fields; // as declared
+		bool reprC = false;
+		bool packed = false;
+		std::uint64_t minAlignment = 1;
+
+		// Set by layOut().
+		std::uint64_t bytes = 0;
+		std::uint64_t alignment = 1;
+
+		TypeStruct(std::string name) : Type(TypeType::structural), name(std::move(name)) {}
+
+		// Where each field goes, by the attributes above.
+		void layOut();
+		auto getField(std::string_view name) const -> std::optional<std::size_t>;
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	// The alignment in memory of a number or a vector, which is its size, or of a
+	// struct, or of what an array holds.
+	auto getTypeAlignment(const Ptr<Type> &t) -> std::uint64_t;
+
+	// The struct an array or slice holds; null for anything else.
+	auto getStructElement(const Ptr<Type> &t) -> TypeStruct *;
+
+	auto isSameType(const Ptr<Type> &a, const Ptr<Type> &b) -> bool;
+
+	// The qualifiers of a pointer or a slice; null for anything else.
+	auto getPointerQualifiers(const Ptr<Type> &t) -> const PointerQualifiers *;
+
+	// `i32x4`, `f32x8`, ...; null for anything else.
+	auto getVectorTypeByName(std::string_view name) -> Ptr<TypeVector>;
+
+	// The type of statements that have no value, like loops.
+	struct TypeUnit : Type
+	{
+		TypeUnit() : Type(TypeType::unit) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	// What a type parameter of a generic function may stand for. A vector stands
+	// for its lanes. `signed` takes the floats too, as isSignedNumericType does.
+	enum class TypeConstraint
+	{
+		any,
+		numeric,
+		integer,
+		floating,
+		signedNumeric,
+		unsignedInteger,
+	};
+
+	// `numeric`, `integer`, `float`, `signed` or `unsigned`.
+	auto getTypeConstraintByName(std::string_view name) -> std::optional<TypeConstraint>;
+	auto getTypeConstraintName(TypeConstraint constraint) -> std::string_view;
+	auto satisfiesConstraint(const Ptr<Type> &t, TypeConstraint constraint) -> bool;
+
+	// A placeholder in the signature and body of a generic function, which each
+	// instance of the function replaces with a type of its own.
+	struct TypeParameter : Type
+	{
+		std::string name;
+		TypeConstraint constraint;
+
+		TypeParameter(std::string name, TypeConstraint constraint)
+			: Type(TypeType::parameter), name(std::move(name)), constraint(constraint) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
+
+	// What each type parameter stands for, by name.
+	using TypeBindings = std::unordered_map<std::string, Ptr<Type>>;
+
+	// Binds the parameters in `param` that are still free so that an argument of
+	// type `arg` fits it. Whether it really does is for the caller to check.
+	void bindTypeParameters(const Ptr<Type> &param, const Ptr<Type> &arg,
+	                        TypeBindings &bindings);
+
+	// `t` with every parameter replaced; null if one is unbound, or bound to
+	// something an array cannot hold while it names the element type of one.
+	auto substituteTypeParameters(const Ptr<Type> &t, const TypeBindings &bindings)
+	    -> Ptr<Type>;
+
 	struct FuncSignature
 	{
 		Ptr<Type> returnType;
 		std::vector<Ptr<Type>> argTypes;
 	};
+
+	// What a function does besides computing its result, as claimed by @pure (it
+	// may read memory) or @const (it reads none, either) and checked against its
+	// body. Stronger claims compare greater.
+	enum class Purity
+	{
+		impure,
+		pure,
+		constant,
+	};
+
+	struct TypeFunction : Type
+	{
+		FuncSignature signature;
+		Purity purity;
+
+		TypeFunction(FuncSignature signature, Purity purity = Purity::impure)
+			: Type(TypeType::function), signature(std::move(signature)), purity(purity) {}
+
+		virtual std::size_t size() const noexcept override;
+		virtual bool assignable(Ptr<Type> out) const noexcept override;
+		virtual void print(std::ostream &out) const noexcept override;
+	};
 }